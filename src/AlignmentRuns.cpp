@@ -0,0 +1,394 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstdio>
+#include "AlignmentRuns.h"
+#include "ExceptionHandler.h"
+#include "FileSystem.h"
+
+constexpr uint64 AlignmentRuns::RESERVE_MIN;
+constexpr uint32 AlignmentRunMerger::CURSOR_BUFFER;
+constexpr uint32 AlignmentRunMerger::FAN_IN_MAX;
+
+template<class T>
+static void write_value(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<class T>
+static void read_value(std::istream &in, T &value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+static void write_string(std::ostream &out, const std::string &value) {
+    write_value(out, (uint32) value.size());
+    out.write(value.data(), value.size());
+}
+
+static void read_string(std::istream &in, std::string &value) {
+    uint32 size = 0;
+
+    read_value(in, size);
+    value.resize(size);
+    if (size > 0) in.read(&value[0], size);
+}
+
+static bool record_less(const AlignmentRuns::Record &a, const AlignmentRuns::Record &b) {
+    if (a.query_id != b.query_id) return a.query_id < b.query_id;
+    if (a.database != b.database) return a.database < b.database;
+    return a.row < b.row;
+}
+
+AlignmentRuns::AlignmentRuns(const std::string &prefix, uint64 budget) {
+    _prefix       = prefix;
+    _budget       = budget;
+    _string_bytes = 0;
+    _size         = 0;
+}
+
+AlignmentRuns::~AlignmentRuns() {
+    for (std::string &path : _run_paths) {
+        std::remove(path.c_str());
+    }
+}
+
+/**
+ * ======================================================================
+ * Function void AlignmentRuns::add(Record &record)
+ *
+ * Description          - Buffers a record, writing a sorted run once the
+ *                        buffer reaches the memory budget
+ *
+ * Notes                - Record contents are moved out, record is left
+ *                        empty
+ *                      - Budget covers the reserved record array, including
+ *                        both arrays while it grows, and string capacity
+ *
+ * @param record        - Alignment record
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void AlignmentRuns::add(Record &record) {
+    uint64 capacity = _buffer.capacity();
+    uint64 grown;
+
+    std::string().swap(record.results.qseqid);      // Runs identify the query by ID
+    if (_buffer.size() == capacity) {
+        // Growing holds the old and new arrays at once, flush rather than exceed budget
+        grown = std::max(RESERVE_MIN, capacity * 2);
+        if (!_buffer.empty() && (capacity + grown) * sizeof(Record) + _string_bytes > _budget) {
+            flush();
+            grown = RESERVE_MIN;
+        }
+        _buffer.reserve(grown);
+    }
+    _string_bytes += string_bytes(record);
+    _buffer.push_back(std::move(record));
+    _size++;
+    if (_buffer.capacity() * sizeof(Record) + _string_bytes >= _budget) flush();
+}
+
+/**
+ * ======================================================================
+ * Function void AlignmentRuns::flush()
+ *
+ * Description          - Sorts buffered records by query and writes them
+ *                        as a new run file
+ *
+ * Notes                - Throws ExceptionHandler if run cannot be written
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void AlignmentRuns::flush() {
+    std::string     path;
+    std::ofstream   out;
+
+    if (_buffer.empty()) return;
+    std::sort(_buffer.begin(), _buffer.end(), record_less);
+
+    path = _prefix + "_" + std::to_string(_run_paths.size()) + ".run";
+    out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    for (const Record &record : _buffer) {
+        write_record(out, record);
+    }
+    out.close();
+    if (out.fail()) {
+        throw ExceptionHandler("Unable to write alignment run: " + path, ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+    }
+    FS_dprint("Wrote " + std::to_string(_buffer.size()) + " alignments to run: " + path);
+    _run_paths.push_back(path);
+
+    std::vector<Record>().swap(_buffer);
+    _string_bytes = 0;
+}
+
+uint64 AlignmentRuns::size() const {
+    return _size;
+}
+
+const std::vector<std::string> &AlignmentRuns::get_run_paths() const {
+    return _run_paths;
+}
+
+uint64 AlignmentRuns::string_bytes(const Record &record) {
+    return record.results.sseqid.capacity() + record.results.stitle.capacity() + record.species.capacity();
+}
+
+void AlignmentRuns::write_record(std::ostream &out, const Record &record) {
+    const SimSearchResults &results = record.results;
+
+    write_value(out, record.query_id);
+    write_value(out, record.database);
+    write_value(out, record.row);
+    write_value(out, results.e_val_raw);
+    write_value(out, results.coverage_raw);
+    write_value(out, results.pident);
+    write_value(out, results.bit_score);
+    write_value(out, results.length);
+    write_value(out, results.mismatch);
+    write_value(out, results.gapopen);
+    write_value(out, results.qstart);
+    write_value(out, results.qend);
+    write_value(out, results.sstart);
+    write_value(out, results.send);
+    write_value(out, results.pident_precision);
+    write_value(out, (uint8) results.is_informative);
+    write_string(out, results.sseqid);
+    write_string(out, results.stitle);
+    write_string(out, record.species);
+}
+
+bool AlignmentRuns::read_record(std::istream &in, Record &record) {
+    SimSearchResults &results = record.results;
+    uint8             informative = 0;
+
+    results = {};
+    read_value(in, record.query_id);
+    if (!in) return false;
+    read_value(in, record.database);
+    read_value(in, record.row);
+    read_value(in, results.e_val_raw);
+    read_value(in, results.coverage_raw);
+    read_value(in, results.pident);
+    read_value(in, results.bit_score);
+    read_value(in, results.length);
+    read_value(in, results.mismatch);
+    read_value(in, results.gapopen);
+    read_value(in, results.qstart);
+    read_value(in, results.qend);
+    read_value(in, results.sstart);
+    read_value(in, results.send);
+    read_value(in, results.pident_precision);
+    read_value(in, informative);
+    results.is_informative = informative != 0;
+    read_string(in, results.sseqid);
+    read_string(in, results.stitle);
+    read_string(in, record.species);
+    if (!in) {
+        throw ExceptionHandler("Truncated alignment run", ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+    }
+    return true;
+}
+
+// **********************************************************************
+
+AlignmentRunMerger::AlignmentRunMerger(const std::string &prefix, uint64 budget) {
+    _prefix = prefix;
+    _budget = budget;
+}
+
+AlignmentRunMerger::~AlignmentRunMerger() {
+    _cursors.clear();       // Close runs before removing them
+    for (std::string &path : _merge_paths) {
+        std::remove(path.c_str());
+    }
+}
+
+bool AlignmentRunMerger::CursorGreater::operator()(uint32 a, uint32 b) const {
+    return record_less((*cursors)[b]->record, (*cursors)[a]->record);
+}
+
+/**
+ * ======================================================================
+ * Function uint32 AlignmentRunMerger::fan_in()
+ *
+ * Description          - Number of runs that may be open at once
+ *
+ * Notes                - Each open run holds a cursor with its read
+ *                        buffer, one more is kept for the output of an
+ *                        intermediate merge
+ *
+ * @return              - Runs merged per pass, at least two
+ *
+ * =====================================================================
+ */
+uint32 AlignmentRunMerger::fan_in() const {
+    uint64 cursors = _budget / sizeof(RunCursor);
+
+    cursors = cursors > 0 ? cursors - 1 : 0;
+    return (uint32) std::max((uint64) 2, std::min(cursors, (uint64) FAN_IN_MAX));
+}
+
+/**
+ * ======================================================================
+ * Function void AlignmentRunMerger::open(const std::vector<std::string> &paths)
+ *
+ * Description          - Opens runs to be merged and reads the first
+ *                        record of each
+ *                      - When there are more runs than the fan in allows,
+ *                        groups are merged into intermediate runs until
+ *                        they can all be open together
+ *
+ * Notes                - Throws ExceptionHandler if a run cannot be opened
+ *                        or written
+ *                      - Records are unique by key, so merge order does not
+ *                        depend on how runs are grouped
+ *
+ * @param paths         - Run files, from any number of AlignmentRuns
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void AlignmentRunMerger::open(const std::vector<std::string> &paths) {
+    CursorGreater               greater;
+    std::vector<std::string>    inputs = paths;
+    std::vector<std::string>    outputs;
+    std::vector<std::string>    group;
+    uint32                      max_runs = fan_in();
+
+    while (inputs.size() > max_runs) {
+        FS_dprint("Merging " + std::to_string(inputs.size()) + " alignment runs, " +
+                  std::to_string(max_runs) + " at a time");
+        outputs.clear();
+        for (uint64 i = 0; i < inputs.size(); i += max_runs) {
+            group.assign(inputs.begin() + i, inputs.begin() + std::min(i + max_runs, (uint64) inputs.size()));
+            outputs.push_back(group.size() == 1 ? group.front() : merge_group(group));
+        }
+        inputs.swap(outputs);
+    }
+
+    for (const std::string &path : inputs) {
+        std::unique_ptr<RunCursor> cursor(new RunCursor());
+        cursor->in.rdbuf()->pubsetbuf(cursor->buffer, sizeof(cursor->buffer));
+        cursor->in.open(path, std::ios::in | std::ios::binary);
+        if (!cursor->in.is_open()) {
+            throw ExceptionHandler("Unable to open alignment run: " + path, ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+        }
+        if (AlignmentRuns::read_record(cursor->in, cursor->record)) {
+            _heap.push_back((uint32) _cursors.size());
+        }
+        _cursors.push_back(std::move(cursor));
+    }
+    greater.cursors = &_cursors;
+    std::make_heap(_heap.begin(), _heap.end(), greater);
+}
+
+/**
+ * ======================================================================
+ * Function std::string AlignmentRunMerger::merge_group(const std::vector<std::string> &paths)
+ *
+ * Description          - Merges a group of runs into one intermediate run
+ *
+ * Notes                - Intermediate runs of this merger in the group are
+ *                        removed once merged
+ *                      - Throws ExceptionHandler if run cannot be written
+ *
+ * @param paths         - Runs to merge, no more than the fan in
+ *
+ * @return              - Path of intermediate run
+ *
+ * =====================================================================
+ */
+std::string AlignmentRunMerger::merge_group(const std::vector<std::string> &paths) {
+    std::string             path;
+    std::ofstream           out;
+    AlignmentRuns::Record   record;
+
+    path = _prefix + "_" + std::to_string(_merge_paths.size()) + ".run";
+    _merge_paths.push_back(path);
+    {
+        AlignmentRunMerger merger(_prefix, _budget);
+
+        merger.open(paths);
+        out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        while (merger.next(record)) {
+            AlignmentRuns::write_record(out, record);
+        }
+        out.close();
+        if (out.fail()) {
+            throw ExceptionHandler("Unable to write alignment run: " + path, ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+        }
+    }
+
+    // Earlier intermediate runs are no longer needed, source runs belong to AlignmentRuns
+    for (const std::string &input : paths) {
+        if (std::find(_merge_paths.begin(), _merge_paths.end(), input) != _merge_paths.end()) {
+            std::remove(input.c_str());
+        }
+    }
+    return path;
+}
+
+/**
+ * ======================================================================
+ * Function bool AlignmentRunMerger::next(AlignmentRuns::Record &record)
+ *
+ * Description          - Returns the next record across all runs in
+ *                        (query ID, database, row) order
+ *
+ * Notes                - None
+ *
+ * @param record        - Set to next record
+ *
+ * @return              - False once every run is exhausted
+ *
+ * =====================================================================
+ */
+bool AlignmentRunMerger::next(AlignmentRuns::Record &record) {
+    CursorGreater greater;
+    uint32        top;
+
+    if (_heap.empty()) return false;
+    greater.cursors = &_cursors;
+    std::pop_heap(_heap.begin(), _heap.end(), greater);
+    top = _heap.back();
+    std::swap(record, _cursors[top]->record);
+    if (AlignmentRuns::read_record(_cursors[top]->in, _cursors[top]->record)) {
+        std::push_heap(_heap.begin(), _heap.end(), greater);
+    } else {
+        _heap.pop_back();
+        _cursors[top]->in.close();
+    }
+    return true;
+}
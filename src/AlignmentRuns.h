@@ -0,0 +1,119 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENTAP_ALIGNMENTRUNS_H
+#define ENTAP_ALIGNMENTRUNS_H
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+#include "QuerySequence.h"
+
+/*
+ * Out of core storage for similarity search alignments. Parsed rows are
+ * buffered up to a memory budget, sorted by query and written to disk as
+ * compact binary runs. AlignmentRunMerger then streams every run of every
+ * database back in (query ID, database, row) order, so all alignments of
+ * one query are seen together, in the order they were parsed. When there
+ * are more runs than the merge budget can hold open, they are first merged
+ * in groups into intermediate runs.
+ *
+ * Run files are temporary and only readable by the build that wrote them.
+ */
+class AlignmentRuns {
+
+public:
+    struct Record {
+        uint32              query_id;   // QueryStore dense ID
+        uint32              database;   // Index of database in search order
+        uint64              row;        // Row within DIAMOND output
+        SimSearchResults    results;    // qseqid is not stored
+        std::string         species;
+    };
+
+    AlignmentRuns(const std::string&, uint64);
+    ~AlignmentRuns();
+    void add(Record&);
+    void flush();
+    uint64 size() const;
+    const std::vector<std::string> &get_run_paths() const;
+
+    static void write_record(std::ostream&, const Record&);
+    static bool read_record(std::istream&, Record&);
+
+private:
+    static constexpr uint64 RESERVE_MIN = 1024;     // Records reserved when a buffer is started
+
+    static uint64 string_bytes(const Record&);
+
+    std::string                 _prefix;        // Run file path prefix
+    uint64                      _budget;        // Bytes buffered before a run is written
+    uint64                      _string_bytes;  // Heap held by buffered record strings
+    uint64                      _size;          // Records added
+    std::vector<Record>         _buffer;
+    std::vector<std::string>    _run_paths;
+};
+
+
+class AlignmentRunMerger {
+
+public:
+    AlignmentRunMerger(const std::string&, uint64);
+    ~AlignmentRunMerger();
+    void open(const std::vector<std::string>&);
+    bool next(AlignmentRuns::Record&);
+
+private:
+    static constexpr uint32 CURSOR_BUFFER = 1 << 16;    // Read buffer per open run
+    static constexpr uint32 FAN_IN_MAX    = 256;        // Runs open at once, regardless of budget
+
+    struct RunCursor {
+        std::ifstream           in;
+        AlignmentRuns::Record   record;
+        char                    buffer[CURSOR_BUFFER];
+    };
+
+    // Orders heap so the smallest key is on top
+    struct CursorGreater {
+        const std::vector<std::unique_ptr<RunCursor>> *cursors;
+        bool operator()(uint32, uint32) const;
+    };
+
+    uint32 fan_in() const;
+    std::string merge_group(const std::vector<std::string>&);
+
+    std::string                             _prefix;        // Intermediate run path prefix
+    uint64                                  _budget;        // Bytes of open cursors allowed
+    std::vector<std::unique_ptr<RunCursor>> _cursors;
+    std::vector<uint32>                     _heap;          // Cursors with a record waiting
+    std::vector<std::string>                _merge_paths;   // Intermediate runs, removed on destruction
+};
+
+
+#endif //ENTAP_ALIGNMENTRUNS_H
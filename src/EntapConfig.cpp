@@ -320,6 +320,7 @@ namespace entapConfig {
         if (_pEntapDatabase == nullptr) {
             throw ExceptionHandler("Unable to allocate Entap Database memory", ERR_ENTAP_MEM_ALLOC);
         }
+        _pEntapDatabase->set_threads((uint32) _pUserInput->get_supported_threads());
 
         // If user would like to generate databases rather than download them from ftp(default)
         generate_databases = _pUserInput->has_input(UInput::INPUT_FLAG_GENERATE);
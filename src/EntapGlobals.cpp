@@ -121,6 +121,12 @@ namespace UInput {
     const std::string INPUT_FLAG_NOCHECK       = "no-check";
     const std::string INPUT_FLAG_GENERATE      = "data-generate";
     const std::string INPUT_FLAG_DATABASE_TYPE = "data-type";
+    const std::string INPUT_FLAG_DMND_STREAM   = "diamond-stream";
+    const std::string INPUT_FLAG_RETAIN_HITS   = "retain-hits";
+    const std::string INPUT_FLAG_SIM_MEMORY    = "sim-search-memory";
+    const std::string INPUT_FLAG_DMND_JOBS     = "diamond-jobs";
+    const std::string INPUT_FLAG_DMND_SHARDS   = "diamond-shards";
+    const std::string INPUT_FLAG_DMND_CASCADE  = "diamond-cascade";
 }
 
 std::string generate_command(std::unordered_map<std::string,std::string> &map,std::string exe_path) {
@@ -49,11 +49,14 @@
 
 
 class QuerySequence;
+class SimSearchAlignment;
+class QueryStore;
 class EntapDatabase;
 class FileSystem;
 class UserInput;
 class GraphingManager;
 class QueryData;
+struct SimSearchResults;
 struct TaxEntry;
 struct GoEntry;
 namespace boostFS = boost::filesystem;
@@ -74,7 +77,6 @@ vect_str_t  split_string(std::string, char);
 
 
 //**************** Global Structures/Typedefs ******************
-typedef std::unordered_map<std::string, QuerySequence*> QUERY_MAP_T;
 typedef std::unordered_map<std::string, TaxEntry> tax_serial_map_t;
 typedef std::unordered_map<std::string, GoEntry> go_serial_map_t;
 typedef std::map<std::string,std::vector<std::string>> go_format_t;
@@ -230,6 +232,12 @@ namespace UInput {
     extern const std::string INPUT_FLAG_NOCHECK;
     extern const std::string INPUT_FLAG_GENERATE;
     extern const std::string INPUT_FLAG_DATABASE_TYPE;
+    extern const std::string INPUT_FLAG_DMND_STREAM;
+    extern const std::string INPUT_FLAG_RETAIN_HITS;
+    extern const std::string INPUT_FLAG_SIM_MEMORY;
+    extern const std::string INPUT_FLAG_DMND_JOBS;
+    extern const std::string INPUT_FLAG_DMND_SHARDS;
+    extern const std::string INPUT_FLAG_DMND_CASCADE;
 }
 
 namespace ENTAP_STATS {
@@ -37,6 +37,7 @@
 #include "config.h"
 #include <ctime>
 #include <cstring>
+#include <mutex>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #ifdef USE_CURL
@@ -51,6 +52,7 @@ const std::string FileSystem::EXT_FAA = ".faa";
 const std::string FileSystem::EXT_FNN = ".fnn";
 const std::string FileSystem::EXT_XML = ".xml";
 const std::string FileSystem::EXT_DMND= ".dmnd";
+const std::string FileSystem::EXT_PART= ".part";
 
 
 // Removed for older compilers, may bring back
@@ -95,7 +97,8 @@ void FileSystem::close_file(std::ofstream &ofstream) {
  * Description          - Handles printing to EnTAP debug file
  *                      - Adds timestamp to each entry
  *
- * Notes                - None
+ * Notes                - Thread safe, entries from concurrent callers are
+ *                        written whole and one at a time
  *
  * @param msg           - Message to be sent to debug file
  * @return              - None
@@ -105,15 +108,19 @@ void FileSystem::close_file(std::ofstream &ofstream) {
 void FS_dprint(const std::string &msg) {
 
 #if DEBUG
-    std::chrono::time_point<std::chrono::system_clock> current;
+    static std::mutex debug_mutex;
     std::time_t time;
+    std::tm     local_time;
+    char        out_time[32];
+
+    time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    localtime_r(&time, &local_time);
+    std::strftime(out_time, sizeof(out_time), "%a %b %e %H:%M:%S %Y", &local_time);
 
-    current = std::chrono::system_clock::now();
-    time = std::chrono::system_clock::to_time_t(current);
-    std::string out_time(std::ctime(&time));
+    std::lock_guard<std::mutex> lock(debug_mutex);
     std::ofstream debug_file(DEBUG_FILE_PATH, std::ios::out | std::ios::app);
 
-    debug_file << out_time.substr(0,out_time.length()-1) << ": " + msg << std::endl;
+    debug_file << out_time << ": " + msg << std::endl;
     debug_file.close();
 #endif
 }
@@ -388,6 +395,27 @@ bool FileSystem::file_no_lines(std::string path) {
 }
 
 
+/**
+ * ======================================================================
+ * Function uint64 FileSystem::get_file_size(const std::string &path)
+ *
+ * Description          - Returns size of a file in bytes
+ *
+ * Notes                - None
+ *
+ * @param path          - Path to file
+ *
+ * @return              - Size in bytes, 0 if file cannot be read
+ *
+ * =====================================================================
+ */
+uint64 FileSystem::get_file_size(const std::string &path) {
+    struct stat buff;
+    if (stat(path.c_str(), &buff) != 0) return 0;
+    return (uint64) buff.st_size;
+}
+
+
 /**
  * ======================================================================
  * Function std::vector<std::string> FS_list_to_vect(char it, std::string &list)
@@ -60,6 +60,7 @@ public:
     bool file_exists(std::string);
     bool file_empty(std::string);
     bool file_no_lines(std::string);
+    uint64 get_file_size(const std::string&);
     bool delete_file(std::string);
     bool copy_file(std::string, std::string, bool);
     bool directory_iterate(bool, std::string&);
@@ -88,6 +89,7 @@ public:
     static const std::string EXT_FNN ;
     static const std::string EXT_DMND;
     static const std::string EXT_XML;
+    static const std::string EXT_PART;
 
 private:
     void init_log();
@@ -0,0 +1,155 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ENTAP_OBJECTPOOL_H
+#define ENTAP_OBJECTPOOL_H
+
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+/*
+ * Typed pool for objects that live for the whole run (query sequences,
+ * alignments). Objects are constructed in place inside large chunks and
+ * destroyed together when the pool is cleared, rather than through
+ * individual new/delete calls. Objects dropped early can be destroyed
+ * individually, their slots are reused by later creates.
+ *
+ * Not thread safe, threads should fill their own pool and hand it over
+ * with adopt().
+ */
+template<class T>
+class ObjectPool {
+
+public:
+    explicit ObjectPool(uint32 chunk_size = DEFAULT_CHUNK_SIZE) {
+        _chunk_size = chunk_size > 0 ? chunk_size : 1;
+        _size       = 0;
+    }
+
+    ~ObjectPool() {
+        clear();
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ObjectPool(ObjectPool &&other) {
+        _chunks     = std::move(other._chunks);
+        _free       = std::move(other._free);
+        _chunk_size = other._chunk_size;
+        _size       = other._size;
+        other._chunks.clear();
+        other._free.clear();
+        other._size = 0;
+    }
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        if (!_free.empty()) {
+            T *object = new (_free.back()) T(std::forward<Args>(args)...);
+            _free.pop_back();
+            _size++;
+            return object;
+        }
+        if (_chunks.empty() || _chunks.back().used == _chunks.back().capacity) {
+            _chunks.push_back(allocate_chunk(_chunk_size));
+        }
+        PoolChunk &chunk = _chunks.back();
+        T *object = new (chunk.memory + (uint64) chunk.used * sizeof(T)) T(std::forward<Args>(args)...);
+        chunk.used++;
+        _size++;
+        return object;
+    }
+
+    // Destroy a single object, its slot is reused by the next create
+    void destroy(T *object) {
+        object->~T();
+        _free.push_back(object);
+        _size--;
+    }
+
+    // Take ownership of every object in another pool, other is left empty
+    void adopt(ObjectPool<T> &other) {
+        if (&other == this) return;
+        _chunks.insert(_chunks.end(), other._chunks.begin(), other._chunks.end());
+        _free.insert(_free.end(), other._free.begin(), other._free.end());
+        _size += other._size;
+        other._chunks.clear();
+        other._free.clear();
+        other._size = 0;
+    }
+
+    // Destroy all objects (in creation order) and release memory
+    void clear() {
+        T *object;
+
+        std::sort(_free.begin(), _free.end());
+        for (PoolChunk &chunk : _chunks) {
+            for (uint32 i = 0; i < chunk.used; i++) {
+                object = reinterpret_cast<T*>(chunk.memory + (uint64) i * sizeof(T));
+                if (!std::binary_search(_free.begin(), _free.end(), object)) object->~T();
+            }
+            ::operator delete(chunk.memory);
+        }
+        _chunks.clear();
+        _free.clear();
+        _size = 0;
+    }
+
+    uint64 size() const {
+        return _size;
+    }
+
+private:
+    struct PoolChunk {
+        char   *memory;
+        uint32  used;
+        uint32  capacity;
+    };
+
+    static PoolChunk allocate_chunk(uint32 capacity) {
+        PoolChunk chunk;
+        chunk.memory   = static_cast<char*>(::operator new((uint64) capacity * sizeof(T)));
+        chunk.used     = 0;
+        chunk.capacity = capacity;
+        return chunk;
+    }
+
+    static constexpr uint32 DEFAULT_CHUNK_SIZE = 4096;   // Objects per chunk
+
+    std::vector<PoolChunk>  _chunks;
+    std::vector<T*>         _free;      // Destroyed slots available for reuse
+    uint32                  _chunk_size;
+    uint64                  _size;
+};
+
+
+#endif //ENTAP_OBJECTPOOL_H
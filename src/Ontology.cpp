@@ -193,7 +193,7 @@ std::unique_ptr<AbstractOntology> Ontology::spawn_object(uint16 &software) {
 
 /**
  * ======================================================================
- * Function void Ontology::print_eggnog(QUERY_MAP_T &SEQUENCES)
+ * Function void Ontology::print_eggnog(QueryStore &SEQUENCES)
  *
  * Description          - Handles printing of final annotation output
  *                      - Current prints tsv file for all go levels specified,
@@ -207,7 +207,7 @@ std::unique_ptr<AbstractOntology> Ontology::spawn_object(uint16 &software) {
  *
  * =====================================================================
  */
-void Ontology::print_eggnog(QUERY_MAP_T &SEQUENCES) {
+void Ontology::print_eggnog(QueryStore &SEQUENCES) {
     FS_dprint("Beginning to print final results...");
     std::map<uint16, std::ofstream*[FINAL_ANNOT_LEN]> file_map;
     std::string file_name;
@@ -240,15 +240,15 @@ void Ontology::print_eggnog(QUERY_MAP_T &SEQUENCES) {
         *file_map[lvl][FINAL_CONTAM_IND] << std::endl;
         *file_map[lvl][FINAL_NO_CONTAM_IND] << std::endl;
     }
-    for (auto &pair : SEQUENCES) {
+    for (QuerySequence *query_seq : SEQUENCES) {
         for (uint16 lvl : _go_levels) {
             for (uint16 i=0; i < FINAL_ANNOT_LEN; i++) {
                 if (i == FINAL_ALL_IND) {
-                    *file_map[lvl][i] << pair.second->print_tsv(_HEADERS, lvl) << std::endl;
-                } else if (i == FINAL_CONTAM_IND && pair.second->isContaminant()) {
-                    *file_map[lvl][i]<< pair.second->print_tsv(_HEADERS,lvl)<<std::endl;
-                } else if (i == FINAL_NO_CONTAM_IND && !pair.second->isContaminant()) {
-                    *file_map[lvl][i]<< pair.second->print_tsv(_HEADERS,lvl)<<std::endl;
+                    *file_map[lvl][i] << query_seq->print_tsv(_HEADERS, lvl) << std::endl;
+                } else if (i == FINAL_CONTAM_IND && query_seq->isContaminant()) {
+                    *file_map[lvl][i]<< query_seq->print_tsv(_HEADERS,lvl)<<std::endl;
+                } else if (i == FINAL_NO_CONTAM_IND && !query_seq->isContaminant()) {
+                    *file_map[lvl][i]<< query_seq->print_tsv(_HEADERS,lvl)<<std::endl;
                 }
             }
         }
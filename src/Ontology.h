@@ -81,7 +81,7 @@ private:
     EntapDatabase                   *_pEntapDatabase;
     EntapDataPtrs                   _entap_data_ptrs;
 
-    void print_eggnog(QUERY_MAP_T&);
+    void print_eggnog(QueryStore&);
     void init_headers();
     std::unique_ptr<AbstractOntology> spawn_object(uint16&);
 };
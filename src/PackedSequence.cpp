@@ -0,0 +1,293 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+#include "PackedSequence.h"
+#include "EntapGlobals.h"
+
+const char PackedSequence::NUCLEO_ALPHABET[]  = "ACGT";
+const char PackedSequence::PROTEIN_ALPHABET[] = "ACDEFGHIKLMNPQRSTVWYBZXJUO*-";
+
+PackedSequence::PackedSequence() {
+    _length     = 0;
+    _line_width = 0;
+    _bits       = NUCLEO_BITS;
+    _stored     = false;
+}
+
+
+/**
+ * ======================================================================
+ * Function void PackedSequence::pack(const char *begin, const char *end,
+ *                                    bool protein)
+ *
+ * Description          - Packs FASTA formatted text into residue codes
+ *                      - Header line (if any) is skipped, it is rebuilt
+ *                        from the sequence ID on output
+ *
+ * Notes                - Empty lines and carriage returns are dropped
+ *
+ * @param begin         - Start of FASTA text
+ * @param end           - End of FASTA text
+ * @param protein       - Amino acid (true) or nucleotide sequence
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void PackedSequence::pack(const char *begin, const char *end, bool protein) {
+    const int8  *table;
+    const char  *eol;
+    const char  *line_end;
+    uint8       *packed;
+    uint64       bit;
+    uint32       length;
+    uint32       lines;
+    uint32       line_len;
+    uint8        shift;
+    uint8        bits;          // Local copy, stores through packed may alias members
+    int8         code;
+    char         c;
+    bool         regular;
+
+    clear();
+    _stored = true;
+    _bits   = protein ? PROTEIN_BITS : NUCLEO_BITS;
+    bits    = _bits;
+    table   = lookup_table(protein);
+
+    if (begin < end && *begin == FASTA_FLAG[0]) {
+        eol   = (const char*) memchr(begin, '\n', (size_t)(end - begin));
+        begin = (eol == nullptr) ? end : eol + 1;
+    }
+    // First pass sizes the packed buffer exactly and checks line wrapping
+    length    = 0;
+    lines     = 0;
+    line_len  = 0;
+    regular   = true;
+    for (const char *pos = begin; pos < end; pos = eol + 1) {
+        eol = (const char*) memchr(pos, '\n', (size_t)(end - pos));
+        if (eol == nullptr) eol = end;
+        line_end = eol;
+        if (line_end > pos && *(line_end - 1) == '\r') line_end--;
+        if (line_end == pos) continue;
+        // Previous line was not the last, must match first line width
+        if (lines > 0 && line_len != _line_width) regular = false;
+        line_len = (uint32) (line_end - pos);
+        if (lines++ == 0) _line_width = line_len;
+        length += line_len;
+    }
+    if (line_len > _line_width) regular = false;
+    if (!regular) _line_ends.reserve(lines);
+
+    _packed.assign(((uint64)length * bits + 7) / 8 + 1, 0);    // Spare byte for straddled codes
+    packed = _packed.data();
+    length = 0;
+    while (begin < end) {
+        eol = (const char*) memchr(begin, '\n', (size_t)(end - begin));
+        if (eol == nullptr) eol = end;
+        line_end = eol;
+        if (line_end > begin && *(line_end - 1) == '\r') line_end--;
+        if (line_end > begin) {
+            for (; begin < line_end; begin++, length++) {
+                c    = *begin;
+                code = table[(uint8) c];
+                if (code < 0) {
+                    add_run(length, c);
+                    continue;
+                }
+                if (c >= 'a') add_run(length, '\0');
+                bit   = (uint64) length * bits;
+                shift = (uint8) (bit & 7);
+                packed[bit >> 3] |= (uint8) (code << shift);
+                if (shift + bits > 8) packed[(bit >> 3) + 1] |= (uint8) (code >> (8 - shift));
+            }
+            if (!regular) _line_ends.push_back(length);
+        }
+        begin = eol + 1;
+    }
+    _length = length;
+    _runs.shrink_to_fit();
+}
+
+void PackedSequence::pack(const std::string &fasta, bool protein) {
+    pack(fasta.data(), fasta.data() + fasta.size(), protein);
+}
+
+
+/**
+ * ======================================================================
+ * Function void PackedSequence::unpack(std::string &out)
+ *
+ * Description          - Decodes residues (no header or line breaks)
+ *
+ * Notes                - None
+ *
+ * @param out           - Set to residues
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void PackedSequence::unpack(std::string &out) const {
+    const char  *alphabet;
+    const uint8 *packed;
+    uint64       bit;
+    char        *residues;
+    uint32       length;
+    uint16       value;
+    uint8        shift;
+    uint8        bits;
+    uint8        mask;
+
+    alphabet = (_bits == PROTEIN_BITS) ? PROTEIN_ALPHABET : NUCLEO_ALPHABET;
+    packed   = _packed.data();
+    bits     = _bits;
+    length   = _length;
+    mask     = (uint8) ((1 << bits) - 1);
+    out.resize(length);
+    residues = &out[0];
+    for (uint32 i = 0; i < length; i++) {
+        bit   = (uint64) i * bits;
+        shift = (uint8) (bit & 7);
+        value = packed[bit >> 3];
+        if (shift + bits > 8) value |= (uint16) (packed[(bit >> 3) + 1] << 8);
+        residues[i] = alphabet[(value >> shift) & mask];
+    }
+    for (const SymbolRun &run : _runs) {
+        for (uint32 i = run.start; i < run.start + run.length; i++) {
+            out[i] = (run.symbol == '\0') ? (char) tolower(out[i]) : run.symbol;
+        }
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function void PackedSequence::write_fasta(std::ostream &out,
+ *                                           const std::string &seq_id)
+ *
+ * Description          - Writes FASTA record with original line wrapping
+ *
+ * Notes                - No trailing newline, matches previous string
+ *                        format of sequences
+ *
+ * @param out           - Output stream
+ * @param seq_id        - Sequence ID used for header
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void PackedSequence::write_fasta(std::ostream &out, const std::string &seq_id) const {
+    std::string residues;
+    uint32      start;
+    uint32      stop;
+
+    out << FASTA_FLAG << seq_id;
+    if (_length == 0) return;
+    unpack(residues);
+    if (_line_ends.empty()) {
+        for (start = 0; start < _length; start += _line_width) {
+            stop = std::min(_length, start + _line_width);
+            out << '\n';
+            out.write(residues.data() + start, stop - start);
+        }
+    } else {
+        start = 0;
+        for (uint32 line_end : _line_ends) {
+            out << '\n';
+            out.write(residues.data() + start, line_end - start);
+            start = line_end;
+        }
+    }
+}
+
+void PackedSequence::clear() {
+    std::vector<uint8>().swap(_packed);
+    std::vector<SymbolRun>().swap(_runs);
+    std::vector<uint32>().swap(_line_ends);
+    _length     = 0;
+    _line_width = 0;
+    _stored     = false;
+}
+
+bool PackedSequence::empty() const {
+    return !_stored;
+}
+
+uint32 PackedSequence::length() const {
+    return _length;
+}
+
+void PackedSequence::add_run(uint32 pos, char symbol) {
+    if (!_runs.empty() && _runs.back().symbol == symbol &&
+        _runs.back().start + _runs.back().length == pos) {
+        _runs.back().length++;
+    } else {
+        _runs.push_back({pos, 1, symbol});
+    }
+}
+
+// Built once, thread safe under C++11 static initialization
+const int8* PackedSequence::lookup_table(bool protein) {
+    struct Tables {
+        int8 nucleo[256];
+        int8 protein[256];
+        Tables() {
+            memset(nucleo, -1, sizeof(nucleo));
+            memset(protein, -1, sizeof(protein));
+            for (int8 i = 0; NUCLEO_ALPHABET[i] != '\0'; i++) {
+                nucleo[(uint8) NUCLEO_ALPHABET[i]] = i;
+                nucleo[(uint8) tolower(NUCLEO_ALPHABET[i])] = i;
+            }
+            for (int8 i = 0; PROTEIN_ALPHABET[i] != '\0'; i++) {
+                protein[(uint8) PROTEIN_ALPHABET[i]] = i;
+                protein[(uint8) tolower(PROTEIN_ALPHABET[i])] = i;
+            }
+        }
+    };
+    static const Tables tables;
+    return protein ? tables.protein : tables.nucleo;
+}
+
+// **********************************************************************
+
+FastaView::FastaView(const PackedSequence *sequence, const std::string *seq_id) {
+    _sequence = sequence;
+    _seq_id   = seq_id;
+}
+
+bool FastaView::empty() const {
+    return _sequence->empty();
+}
+
+std::ostream& operator<<(std::ostream &out, const FastaView &view) {
+    if (!view.empty()) view._sequence->write_fasta(out, *view._seq_id);
+    return out;
+}
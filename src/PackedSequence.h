@@ -0,0 +1,96 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ENTAP_PACKEDSEQUENCE_H
+#define ENTAP_PACKEDSEQUENCE_H
+
+#include "common.h"
+
+/*
+ * Residues stored at 2 bits (nucleotide) or 5 bits (amino acid) each.
+ * Symbols outside of the alphabet (N, IUPAC codes...) and soft-masked
+ * (lowercase) stretches are kept as runs so the original text can be
+ * rebuilt exactly. Line wrapping is kept as a single width unless the
+ * input was wrapped irregularly.
+ */
+class PackedSequence {
+
+public:
+    PackedSequence();
+    void pack(const char*, const char*, bool);
+    void pack(const std::string&, bool);
+    void unpack(std::string&) const;
+    void write_fasta(std::ostream&, const std::string&) const;
+    void clear();
+    bool empty() const;
+    uint32 length() const;
+
+private:
+    struct SymbolRun {
+        uint32 start;
+        uint32 length;
+        char   symbol;      // '\0' - lowercase stretch of packed residues
+    };
+
+    void add_run(uint32, char);
+
+    static const int8* lookup_table(bool);
+
+    static constexpr uint8 NUCLEO_BITS = 2;
+    static constexpr uint8 PROTEIN_BITS= 5;
+    static const char      NUCLEO_ALPHABET[];
+    static const char      PROTEIN_ALPHABET[];
+
+    std::vector<uint8>      _packed;
+    std::vector<SymbolRun>  _runs;          // Sorted by start
+    std::vector<uint32>     _line_ends;     // Only used with irregular wrapping
+    uint32                  _length;        // Residue count
+    uint32                  _line_width;
+    uint8                   _bits;
+    bool                    _stored;
+};
+
+
+/*
+ * Lightweight handle returned in place of a FASTA formatted string.
+ * Header and line breaks are rebuilt when written to a stream.
+ */
+class FastaView {
+
+public:
+    FastaView(const PackedSequence*, const std::string*);
+    bool empty() const;
+    friend std::ostream& operator<<(std::ostream&, const FastaView&);
+
+private:
+    const PackedSequence *_sequence;
+    const std::string    *_seq_id;
+};
+
+
+#endif //ENTAP_PACKEDSEQUENCE_H
@@ -0,0 +1,162 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cctype>
+#include <queue>
+#include "PatternMatcher.h"
+
+constexpr PatternMatcher::state_t PatternMatcher::STATE_ROOT;
+constexpr PatternMatcher::state_t PatternMatcher::STATE_NONE;
+constexpr uint16 PatternMatcher::ALPHABET_MAX;
+
+PatternMatcher::PatternMatcher() {
+    build(std::vector<std::string>());
+}
+
+/**
+ * ======================================================================
+ * Function void PatternMatcher::build(const std::vector<std::string> &patterns)
+ *
+ * Description          - Builds automaton from a list of terms, replacing
+ *                        any previous terms
+ *                      - Terms are added to a trie, then failure links
+ *                        are resolved breadth first into full transitions
+ *
+ * Notes                - Matching is case-insensitive
+ *                      - An empty term matches every text
+ *
+ * @param patterns      - Terms to search for
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void PatternMatcher::build(const std::vector<std::string> &patterns) {
+    std::queue<state_t> states;
+    std::vector<state_t> failure;
+    state_t state;
+    state_t next;
+    uint16  column;
+    uint16  lower;
+
+    // Column 0 is shared by all characters not found in any term
+    std::fill(_alphabet, _alphabet + ALPHABET_MAX, 0);
+    _alphabet_size = 1;
+    for (const std::string &pattern : patterns) {
+        for (unsigned char c : pattern) {
+            lower = (uint16) std::tolower(c);
+            if (_alphabet[lower] != 0) continue;
+            _alphabet[lower] = _alphabet_size;
+            _alphabet[std::toupper(lower)] = _alphabet_size;
+            _alphabet_size++;
+        }
+    }
+
+    _pattern_count = (uint32) patterns.size();
+    _transitions.clear();
+    _accepting.clear();
+    add_state();
+
+    // Trie of terms
+    for (const std::string &pattern : patterns) {
+        state = STATE_ROOT;
+        for (unsigned char c : pattern) {
+            column = _alphabet[c];
+            next = _transitions[state * _alphabet_size + column];
+            if (next == STATE_NONE) {
+                next = add_state();
+                _transitions[state * _alphabet_size + column] = next;
+            }
+            state = next;
+        }
+        _accepting[state] = 1;
+    }
+
+    // Resolve failure links into transitions
+    failure.assign(_accepting.size(), STATE_ROOT);
+    for (column = 0; column < _alphabet_size; column++) {
+        next = _transitions[column];
+        if (next == STATE_NONE) {
+            _transitions[column] = STATE_ROOT;
+        } else {
+            states.push(next);
+        }
+    }
+    while (!states.empty()) {
+        state = states.front();
+        states.pop();
+        if (_accepting[failure[state]]) _accepting[state] = 1;
+        for (column = 0; column < _alphabet_size; column++) {
+            next = _transitions[state * _alphabet_size + column];
+            if (next == STATE_NONE) {
+                _transitions[state * _alphabet_size + column] =
+                        _transitions[failure[state] * _alphabet_size + column];
+            } else {
+                failure[next] = _transitions[failure[state] * _alphabet_size + column];
+                states.push(next);
+            }
+        }
+    }
+}
+
+/**
+ * ======================================================================
+ * Function bool PatternMatcher::matches(const std::string &text) const
+ *
+ * Description          - Checks whether any term occurs in text
+ *
+ * Notes                - Case-insensitive
+ *
+ * @param text          - Text to search
+ *
+ * @return              - True if a term was found
+ *
+ * =====================================================================
+ */
+bool PatternMatcher::matches(const std::string &text) const {
+    state_t state = STATE_ROOT;
+
+    if (_pattern_count == 0) return false;
+    if (_accepting[STATE_ROOT]) return true;
+    for (unsigned char c : text) {
+        state = _transitions[state * _alphabet_size + _alphabet[c]];
+        if (_accepting[state]) return true;
+    }
+    return false;
+}
+
+bool PatternMatcher::empty() const {
+    return _pattern_count == 0;
+}
+
+PatternMatcher::state_t PatternMatcher::add_state() {
+    _transitions.insert(_transitions.end(), _alphabet_size, STATE_NONE);
+    _accepting.push_back(0);
+    return (state_t) _accepting.size() - 1;
+}
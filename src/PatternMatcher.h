@@ -0,0 +1,69 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENTAP_PATTERNMATCHER_H
+#define ENTAP_PATTERNMATCHER_H
+
+#include <string>
+#include <vector>
+#include "common.h"
+
+/*
+ * Case-insensitive Aho-Corasick automaton. Built once from a list of
+ * terms and then checks whether any of them occurs in a text with a
+ * single pass over it, regardless of how many terms there are.
+ *
+ * Transitions are stored as a dense table over the characters used by
+ * the terms only (all other characters share one column), so matching
+ * is one table lookup per character.
+ */
+class PatternMatcher {
+
+public:
+    PatternMatcher();
+    void build(const std::vector<std::string>&);
+    bool matches(const std::string&) const;
+    bool empty() const;
+
+private:
+    typedef uint32 state_t;
+
+    static constexpr state_t STATE_ROOT = 0;
+    static constexpr state_t STATE_NONE = 0xFFFFFFFF;
+    static constexpr uint16  ALPHABET_MAX = 256;
+
+    uint16                  _alphabet[ALPHABET_MAX];   // Character -> column (0 = unused character)
+    uint16                  _alphabet_size;
+    uint32                  _pattern_count;
+    std::vector<state_t>    _transitions;               // State * _alphabet_size + column
+    std::vector<uint8>      _accepting;                 // State ends a term (or its suffix does)
+
+    state_t add_state();
+};
+
+
+#endif //ENTAP_PATTERNMATCHER_H
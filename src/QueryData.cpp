@@ -26,6 +26,9 @@
 */
 
 #include <iomanip>
+#include <cstring>
+#include <thread>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include "QueryData.h"
 #include "ExceptionHandler.h"
 #include "FileSystem.h"
@@ -35,20 +38,23 @@
  * ======================================================================
  * Function QueryData::QueryData(std::string &input_file,
  *                              std::string &out_path,
- *                              bool &is_complete,
- *                              bool &trim)
+ *                              UserInput *userinput,
+ *                              FileSystem *filesystem)
  *
  * Description          - Parses input transcriptome and converts to map of
  *                        each query sequence
  *                      - This map is passed throughout EnTAP execution and
  *                        updated
+ *                      - Transcriptome is memory mapped, split into record
+ *                        aligned chunks and parsed by multiple threads
+ *                      - Normalized copy is written through a large buffer
  *
- * Notes                - None
+ * Notes                - Empty lines and carriage returns are dropped
  *
- * @param input_file    - Path to input transcriptome
- * @param trim          - Flag from user to trim sequence ID to first space
- * @param is_complete   - Flag from user if the entire transcriptome is a
- *                        complete gene
+ * @param input_file    - Path to input transcriptome, set to normalized copy
+ * @param out_path      - Directory for normalized transcriptome
+ * @param userinput     - User input (trim/complete/thread flags)
+ * @param filesystem    - EnTAP filesystem
  * @return              - None
  *
  * =====================================================================
@@ -60,12 +66,19 @@ QueryData::QueryData(std::string &input_file, std::string &out_path, UserInput *
     std::stringstream                        out_msg;
     std::string                              out_name;
     std::string                              out_new_path;
-    std::string                              line;
-    std::string                              sequence;
-    std::string                              seq_id;
     std::string                              longest_seq;
     std::string                              shortest_seq;
     std::string                              transcript_type;
+    std::string                              duplicate_id;
+    std::vector<char>                        out_buffer;
+    std::vector<FastaChunk>                  chunks;
+    std::vector<std::thread>                 workers;
+    boost::iostreams::mapped_file_source     in_map;
+    std::ofstream                            out_file;
+    const char                              *data;
+    const char                              *split;
+    uint64                                   map_size;
+    uint32                                   thread_count;
     uint32                                   count_seqs=0;
     uint64                                   total_len=0;
     uint16                                   shortest_len=10000;
@@ -79,7 +92,9 @@ QueryData::QueryData(std::string &input_file, std::string &out_path, UserInput *
     _total_sequences = 0;
     _pipeline_flags  = 0;
     _data_flags      = 0;
-    _pSEQUENCES      = new QUERY_MAP_T;
+    _pSEQUENCES      = new QueryStore();
+    _pSequencePool   = new ObjectPool<QuerySequence>();
+    _pAlignmentPool  = new ObjectPool<SimSearchAlignment>();
 
     _pUserInput  = userinput;
     _pFileSystem = filesystem;
@@ -90,6 +105,9 @@ QueryData::QueryData(std::string &input_file, std::string &out_path, UserInput *
     if (!_pFileSystem->file_exists(input_file)) {
         throw ExceptionHandler("Input transcriptome not found at: " + input_file,ERR_ENTAP_INPUT_PARSE);
     }
+    if (_pFileSystem->file_empty(input_file)) {
+        throw ExceptionHandler("Input transcriptome is empty: " + input_file,ERR_ENTAP_INPUT_PARSE);
+    }
 
     out_name     = _pFileSystem->get_filename(input_file);
     out_new_path = PATHS(out_path,out_name);
@@ -98,46 +116,80 @@ QueryData::QueryData(std::string &input_file, std::string &out_path, UserInput *
     set_input_type(input_file);
     _protein ? transcript_type = PROTEIN_FLAG : transcript_type = NUCLEO_FLAG;
 
-    std::ifstream in_file(input_file);
-    std::ofstream out_file(out_new_path,std::ios::out | std::ios::app);
+    try {
+        in_map.open(input_file);
+    } catch (const std::exception &e) {
+        throw ExceptionHandler("Unable to map input transcriptome: " + input_file + "\n" + e.what(),
+                               ERR_ENTAP_INPUT_PARSE);
+    }
+    data     = in_map.data();
+    map_size = in_map.size();
+
+    // Split mapped file into byte ranges, each starting on a header line
+    thread_count = (uint32) std::max(1, _pUserInput->get_supported_threads());
+    thread_count = (uint32) std::min((uint64) thread_count, map_size / CHUNK_MIN_SIZE + 1);
+    chunks.resize(thread_count);
+    split = data;
+    for (uint32 i = 0; i < thread_count; i++) {
+        chunks[i].begin = split;
+        if (i == thread_count - 1) {
+            split = data + map_size;
+        } else {
+            split = std::max(split, data + (map_size / thread_count) * (i + 1));
+            split = find_record_start(split, data + map_size);
+        }
+        chunks[i].end = split;
+    }
+    FS_dprint("Parsing transcriptome with " + std::to_string(thread_count) + " threads");
 
-    while (true) {
-        std::getline(in_file, line);
-        if (line.empty() && !in_file.eof()) continue;
-        if (line.find(FASTA_FLAG) == 0 || in_file.eof()) {
-            if (!seq_id.empty()) {
-                if (in_file.eof()) {
-                    out_file << line << std::endl;
-                    sequence += line + "\n";
-                }
-                QuerySequence *query_seq = new QuerySequence(_protein,sequence, seq_id);
-                if (is_complete) query_seq->setFrame(COMPLETE_FLAG);
-                if (_pSEQUENCES->find(seq_id) != _pSEQUENCES->end()) {
-                    throw ExceptionHandler("Duplicate headers in your input transcriptome: " + seq_id,
-                        ERR_ENTAP_INPUT_PARSE);
-                }
-                _pSEQUENCES->emplace(seq_id, query_seq);
-                count_seqs++;
-                len = (uint16) query_seq->getSeq_length();
-                total_len += len;
-                if (len > longest_len) {
-                    longest_len = len;longest_seq = seq_id;
-                }
-                if (len < shortest_len) {
-                    shortest_len = len;shortest_seq = seq_id;
-                }
-                sequence_lengths.push_back(len);
+    for (uint32 i = 1; i < thread_count; i++) {
+        workers.push_back(std::thread(&QueryData::parse_fasta_chunk, this, &chunks[i], is_complete));
+    }
+    parse_fasta_chunk(&chunks[0], is_complete);
+    for (std::thread &worker : workers) worker.join();
+    in_map.close();
+
+    // Merge chunks in input order, catching duplicates across chunk boundaries
+    for (FastaChunk &chunk : chunks) count_seqs += (uint32) chunk.sequences.size();
+    _pSEQUENCES->reserve(count_seqs);
+    sequence_lengths.reserve(count_seqs);
+    for (FastaChunk &chunk : chunks) {
+        _pSequencePool->adopt(chunk.pool);
+        for (uint32 i = 0; i < chunk.sequences.size(); i++) {
+            QuerySequence *query_seq = chunk.sequences[i];
+            if (_pSEQUENCES->add(query_seq, chunk.hashes[i]) == QueryStore::QUERY_ID_NONE) {
+                if (duplicate_id.empty()) duplicate_id = query_seq->get_seq_id();
+                continue;
             }
-            if (in_file.eof()) break;
-            sequence = trim_sequence_header(seq_id, line);
-            out_file << sequence;
-        } else {
-            out_file << line << std::endl;
-            sequence += line + "\n";
+            len = (uint16) query_seq->getSeq_length();
+            total_len += len;
+            if (len > longest_len) {
+                longest_len = len;longest_seq = query_seq->get_seq_id();
+            }
+            if (len < shortest_len) {
+                shortest_len = len;shortest_seq = query_seq->get_seq_id();
+            }
+            sequence_lengths.push_back(len);
         }
     }
-    in_file.close();
+    if (!duplicate_id.empty()) {
+        throw ExceptionHandler("Duplicate headers in your input transcriptome: " + duplicate_id,
+            ERR_ENTAP_INPUT_PARSE);
+    }
+    if (count_seqs == 0) {
+        throw ExceptionHandler("No sequences found in input transcriptome: " + input_file,
+                               ERR_ENTAP_INPUT_PARSE);
+    }
+
+    // Buffer must be set before the file is opened to take effect
+    out_buffer.resize(OUT_BUFFER_SIZE);
+    out_file.rdbuf()->pubsetbuf(out_buffer.data(), out_buffer.size());
+    out_file.open(out_new_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    for (QuerySequence *query_seq : *_pSEQUENCES) {
+        out_file << query_seq->get_sequence() << '\n';
+    }
     out_file.close();
+
     avg_len = total_len / count_seqs;
     _total_sequences = count_seqs;
     _protein  ? _start_prot_len = total_len : _start_nuc_len = total_len;
@@ -164,6 +216,128 @@ QueryData::QueryData(std::string &input_file, std::string &out_path, UserInput *
 }
 
 
+/**
+ * ======================================================================
+ * Function void QueryData::parse_sequence_header(const char *begin,
+ *                                                const char *end,
+ *                                                std::string &header)
+ *
+ * Description          - Pulls sequence ID from a FASTA header line in place
+ *                      - Same rules as trim_sequence_header without
+ *                        building temporary strings
+ *
+ * Notes                - Line must begin with '>', newline excluded
+ *
+ * @param begin         - Start of header line
+ * @param end           - End of header line
+ * @param header        - Set to sequence ID
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void QueryData::parse_sequence_header(const char *begin, const char *end, std::string &header) {
+    const char *space;
+
+    begin++;    // Skip '>'
+    header.clear();
+    if (_trim) {
+        space = (const char*) memchr(begin, ' ', (size_t)(end - begin));
+        if (space != nullptr) end = space;
+        header.assign(begin, (size_t)(end - begin));
+    } else {
+        for (; begin < end; begin++) {
+            if (!isspace((unsigned char)*begin)) header += *begin;
+        }
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function void QueryData::parse_fasta_chunk(FastaChunk *chunk,
+ *                                            bool is_complete)
+ *
+ * Description          - Scans one byte range of the mapped transcriptome
+ *                        and builds a QuerySequence for every record
+ *                      - Run concurrently, one chunk per thread
+ *
+ * Notes                - Chunk should start on a header line. Only touches
+ *                        its own chunk, sequences are merged afterwards
+ *
+ * @param chunk         - Byte range to parse, sequences stored here
+ * @param is_complete   - Flag sequences as complete genes
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void QueryData::parse_fasta_chunk(FastaChunk *chunk, bool is_complete) {
+    std::string     seq_id;
+    const char     *pos;
+    const char     *eol;
+    const char     *line_end;
+    const char     *record;         // Start of current sequence lines
+    bool            at_end;
+
+    pos    = chunk->begin;
+    record = pos;
+    while (true) {
+        at_end = pos >= chunk->end;
+        eol = line_end = chunk->end;
+        if (!at_end) {
+            eol = (const char*) memchr(pos, '\n', (size_t)(chunk->end - pos));
+            if (eol == nullptr) eol = chunk->end;
+            line_end = eol;
+        }
+        if (at_end || *pos == FASTA_FLAG[0]) {
+            if (!seq_id.empty()) {
+                // Residues packed straight from the mapped file
+                QuerySequence *query_seq = chunk->pool.create(_protein, record,
+                                                              std::min(pos, chunk->end), seq_id);
+                if (is_complete) query_seq->setFrame(COMPLETE_FLAG);
+                chunk->sequences.push_back(query_seq);
+                chunk->hashes.push_back(QueryStore::hash(seq_id.data(), seq_id.size()));
+            }
+            if (at_end) break;
+            if (line_end > pos && *(line_end - 1) == '\r') line_end--;
+            parse_sequence_header(pos, line_end, seq_id);
+            record = std::min(eol + 1, chunk->end);
+        }
+        pos = eol + 1;
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function const char* QueryData::find_record_start(const char *pos,
+ *                                                   const char *end)
+ *
+ * Description          - Moves forward to the next line beginning with '>'
+ *
+ * Notes                - Used to align chunk boundaries on records
+ *
+ * @param pos           - Position to begin search
+ * @param end           - End of mapped file
+ *
+ * @return              - Start of next header line, end if none
+ *
+ * =====================================================================
+ */
+const char* QueryData::find_record_start(const char *pos, const char *end) {
+    const char *eol;
+
+    while (pos < end) {
+        eol = (const char*) memchr(pos, '\n', (size_t)(end - pos));
+        if (eol == nullptr) return end;
+        pos = eol + 1;
+        if (pos < end && *pos == FASTA_FLAG[0]) return pos;
+    }
+    return end;
+}
+
+
 void QueryData::set_input_type(std::string &in) {
     std::string    line;
     uint8          line_count;
@@ -233,12 +407,13 @@ std::pair<uint16, uint16> QueryData::calculate_N_vals (ExecuteStates state, bool
     fp64   fifty_len;
     fp64   ninety_len;
 
-    // Recalculate based upon what sequences are left (kept)
-    for (auto &pair : *_pSEQUENCES) {
-        if (pair.second->is_kept()) {
-            total_len += pair.second->getSeq_length();
+    // Recalculate based upon what sequences are left (kept), from store columns
+    const uint16 kept_flags = QuerySequence::QUERY_EXPRESSION_KEPT | QuerySequence::QUERY_FRAME_KEPT;
+    for (uint32 query_id = 0; query_id < _pSEQUENCES->size(); query_id++) {
+        if ((_pSEQUENCES->get_flags(query_id) & kept_flags) == kept_flags) {
+            total_len += _pSEQUENCES->get_length(query_id);
             total_seq++;
-            seq_len_vect.push_back((uint16)pair.second->getSeq_length());
+            seq_len_vect.push_back((uint16)_pSEQUENCES->get_length(query_id));
         }
     }
 
@@ -278,18 +453,21 @@ std::pair<uint16, uint16> QueryData::calculate_N_vals (ExecuteStates state, bool
  * ======================================================================
  */
 void QueryData::flag_transcripts(ExecuteStates state) {
-    for (auto &pair : *_pSEQUENCES) {
-        switch (state) {
-            case EXPRESSION_FILTERING:
-                pair.second->QUERY_FLAG_SET(QuerySequence::QUERY_EXPRESSION_KEPT);
-                break;
-            case FRAME_SELECTION:
-                pair.second->QUERY_FLAG_SET(QuerySequence::QUERY_IS_PROTEIN);        // Probably already done
-                pair.second->QUERY_FLAG_SET(QuerySequence::QUERY_FRAME_KEPT);
-                break;
-            default:
-                break;
-        }
+    uint16 flags;
+
+    switch (state) {
+        case EXPRESSION_FILTERING:
+            flags = QuerySequence::QUERY_EXPRESSION_KEPT;
+            break;
+        case FRAME_SELECTION:
+            flags = QuerySequence::QUERY_IS_PROTEIN |       // Probably already done
+                    QuerySequence::QUERY_FRAME_KEPT;
+            break;
+        default:
+            return;
+    }
+    for (uint32 query_id = 0; query_id < _pSEQUENCES->size(); query_id++) {
+        _pSEQUENCES->flags(query_id) |= flags;
     }
 }
 
@@ -358,14 +536,16 @@ void QueryData::final_statistics(std::string &outpath, std::vector<uint16> &onto
     std::ofstream file_annotated_nucl(out_annotated_nucl_path, std::ios::out | std::ios::app);
     std::ofstream file_annotated_prot(out_annotated_prot_path, std::ios::out | std::ios::app);
 
-    for (auto &pair : *_pSEQUENCES) {
+    for (uint32 query_id = 0; query_id < _pSEQUENCES->size(); query_id++) {
+        QuerySequence *query_seq = _pSEQUENCES->at(query_id);
+        uint16         flags     = _pSEQUENCES->get_flags(query_id);
         count_total_sequences++;
-        is_exp_kept = pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_EXPRESSION_KEPT);
-        is_prot = pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_IS_PROTEIN);
-        is_hit = pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_BLAST_HIT);
-        is_ontology = pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_FAMILY_ASSIGNED); // TODO Fix for interpro
-        is_one_go = pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_ONE_GO);
-        is_one_kegg = pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_ONE_KEGG);
+        is_exp_kept = (flags & QuerySequence::QUERY_EXPRESSION_KEPT) != 0;
+        is_prot = (flags & QuerySequence::QUERY_IS_PROTEIN) != 0;
+        is_hit = (flags & QuerySequence::QUERY_BLAST_HIT) != 0;
+        is_ontology = (flags & QuerySequence::QUERY_FAMILY_ASSIGNED) != 0; // TODO Fix for interpro
+        is_one_go = (flags & QuerySequence::QUERY_ONE_GO) != 0;
+        is_one_kegg = (flags & QuerySequence::QUERY_ONE_KEGG) != 0;
 
         is_exp_kept ? count_exp_kept++ : count_exp_reject++;
         is_prot ? count_frame_kept++ : count_frame_rejected++;
@@ -380,17 +560,17 @@ void QueryData::final_statistics(std::string &outpath, std::vector<uint16> &onto
         if (is_hit || is_ontology) {
             // Is annotated
             count_TOTAL_ann++;
-            if (!pair.second->get_sequence_n().empty())
-                file_annotated_nucl<<pair.second->get_sequence_n()<<std::endl;
-            if (!pair.second->get_sequence_p().empty()) {
-                file_annotated_prot<<pair.second->get_sequence_p()<<std::endl;
+            if (!query_seq->get_sequence_n().empty())
+                file_annotated_nucl<<query_seq->get_sequence_n()<<std::endl;
+            if (!query_seq->get_sequence_p().empty()) {
+                file_annotated_prot<<query_seq->get_sequence_p()<<std::endl;
             }
         } else {
             // Not annotated
-            if (!pair.second->get_sequence_n().empty())
-                file_unannotated_nucl<<pair.second->get_sequence_n()<<std::endl;
-            if (!pair.second->get_sequence_p().empty()) {
-                file_unannotated_prot<<pair.second->get_sequence_p()<<std::endl;
+            if (!query_seq->get_sequence_n().empty())
+                file_unannotated_nucl<<query_seq->get_sequence_n()<<std::endl;
+            if (!query_seq->get_sequence_p().empty()) {
+                file_unannotated_prot<<query_seq->get_sequence_p()<<std::endl;
             }
             count_TOTAL_unann++;
         }
@@ -480,17 +660,20 @@ void QueryData::set_frame_stats(const FrameStats &_frame_stats) {
     QueryData::_frame_stats = _frame_stats;
 }
 
-QUERY_MAP_T* QueryData::get_sequences_ptr() {
+QueryStore* QueryData::get_sequences_ptr() {
     return this->_pSEQUENCES;
 }
 
+ObjectPool<SimSearchAlignment>* QueryData::get_alignment_pool() {
+    return this->_pAlignmentPool;
+}
+
 QueryData::~QueryData() {
     FS_dprint("Killing QueryData object...");
-    for(QUERY_MAP_T::iterator it = _pSEQUENCES->begin(); it != _pSEQUENCES->end(); it++) {
-        delete it->second;
-        it->second = nullptr;
-    }
     SAFE_DELETE(_pSEQUENCES);
+    // Sequences and alignments are released in bulk
+    SAFE_DELETE(_pAlignmentPool);
+    SAFE_DELETE(_pSequencePool);
 }
 
 bool QueryData::DATA_FLAG_GET(DATA_FLAGS flag) {
@@ -506,14 +689,8 @@ void QueryData::DATA_FLAG_CLEAR(DATA_FLAGS flag) {
 }
 
 QuerySequence *QueryData::get_sequence(std::string &query_id) {
-    QUERY_MAP_T::iterator it = _pSEQUENCES->find(query_id);
-    if (it != _pSEQUENCES->end()) {
-        // Sequence found, return
-        return it->second;
-    } else {
-        // Sequence NOT found retun null
-        return nullptr;
-    }
+    // nullptr if sequence not found
+    return _pSEQUENCES->find(query_id);
 }
 
 
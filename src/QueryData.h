@@ -31,6 +31,8 @@
 
 
 #include "QuerySequence.h"
+#include "QueryStore.h"
+#include "ObjectPool.h"
 #include "EntapExecute.h"
 
 struct FrameStats {
@@ -59,7 +61,8 @@ public:
     QueryData(std::string&, std::string&, UserInput*, FileSystem*);
     ~QueryData();
 
-    QUERY_MAP_T* get_sequences_ptr();
+    QueryStore* get_sequences_ptr();
+    ObjectPool<SimSearchAlignment>* get_alignment_pool();
 
     void flag_transcripts(ExecuteStates);
     std::pair<uint16, uint16> calculate_N_vals(std::vector<uint16>&,uint64);
@@ -73,11 +76,25 @@ public:
     QuerySequence* get_sequence(std::string&);
 
 private:
+    // Byte range of the mapped transcriptome parsed by one thread
+    struct FastaChunk {
+        const char                  *begin;
+        const char                  *end;
+        std::vector<QuerySequence*>  sequences;     // Input order
+        std::vector<uint64>          hashes;        // QueryStore hash of each sequence ID
+        ObjectPool<QuerySequence>    pool;          // Owns sequences until merged
+    };
+
     void set_input_type(std::string&);
+    void parse_sequence_header(const char*, const char*, std::string&);
+    void parse_fasta_chunk(FastaChunk*, bool);
+    const char* find_record_start(const char*, const char*);
 
     const uint8         LINE_COUNT   = 20;
     const uint8         SEQ_DPRINT_CONUT = 10;
     const uint8         NUCLEO_DEV   = 2;
+    const uint32        OUT_BUFFER_SIZE = (1 << 22);   // Normalized transcriptome write buffer
+    const uint32        CHUNK_MIN_SIZE  = (1 << 20);   // Smallest byte range given to a thread
     const fp32          N_50_PERCENT = 0.5;
     const fp32          N_90_PERCENT = 0.9;
     const std::string   NUCLEO_FLAG  = "Nucleotide";
@@ -95,7 +112,9 @@ private:
     const std::string OUT_ANNOTATED_NUCL   = "final_annotated.fnn";
     const std::string OUT_ANNOTATED_PROT   = "final_annotated.faa";
 
-    QUERY_MAP_T  *_pSEQUENCES;
+    QueryStore   *_pSEQUENCES;
+    ObjectPool<QuerySequence>      *_pSequencePool;     // Owns every QuerySequence
+    ObjectPool<SimSearchAlignment> *_pAlignmentPool;    // Owns every similarity search alignment
     bool         _trim;
     bool         _protein;
     uint32       _total_sequences;          // Original sequence number
@@ -31,13 +31,14 @@
 #include <sstream>
 #include <netinet/in.h>
 #include "QuerySequence.h"
+#include "QueryStore.h"
 #include "EntapGlobals.h"
 #include "FileSystem.h"
 #include "common.h"
 #include "ExceptionHandler.h"
 
 unsigned long QuerySequence::getSeq_length() const {
-    return _seq_length;
+    return _pStore != nullptr ? _pStore->get_length(_query_id) : _seq_length;
 }
 
 QuerySequence::QuerySequence() {
@@ -47,46 +48,57 @@ QuerySequence::QuerySequence() {
 
 void QuerySequence::setSequence( std::string &seq) {
     QUERY_FLAG_SET(QUERY_IS_PROTEIN);
-    _seq_length = calc_seq_length(seq,true);
-    if (!seq.empty() && seq[seq.length()-1] == '\n') {
-        seq.pop_back();
-    }
-    _sequence_p = seq;
+    _sequence_p.pack(seq, true);
+    length_ref() = _sequence_p.length() * 3;
 }
 
-const std::string &QuerySequence::get_sequence_p() const {
-    return _sequence_p;
+FastaView QuerySequence::get_sequence_p() const {
+    return FastaView(&_sequence_p, &_seq_id);
 }
 
 void QuerySequence::set_sequence_p(const std::string &_sequence_p) {
-    QuerySequence::_sequence_p = _sequence_p;
+    QuerySequence::_sequence_p.pack(_sequence_p, true);
 }
 
-const std::string &QuerySequence::get_sequence_n() const {
-    return _sequence_n;
+FastaView QuerySequence::get_sequence_n() const {
+    return FastaView(&_sequence_n, &_seq_id);
 }
 
 void QuerySequence::set_sequence_n(const std::string &_sequence_n) {
-    QuerySequence::_sequence_n = _sequence_n;
+    QuerySequence::_sequence_n.pack(_sequence_n, false);
 }
 
-QuerySequence::QuerySequence(bool is_protein, std::string seq, std::string seqid){
+/**
+ * ======================================================================
+ * Function QuerySequence::QuerySequence(bool is_protein, const char *begin,
+ *                                      const char *end,
+ *                                      const std::string &seqid)
+ *
+ * Description          - Packs sequence record from transcriptome text
+ *
+ * Notes                - Header line is optional, rebuilt from seqid
+ *
+ * @param is_protein    - Amino acid (true) or nucleotide sequence
+ * @param begin         - Start of FASTA record
+ * @param end           - End of FASTA record
+ * @param seqid         - Sequence ID
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+QuerySequence::QuerySequence(bool is_protein, const char *begin, const char *end,
+                             const std::string &seqid){
     init_sequence();
     this->_seq_id = seqid;
     is_protein ? this->QUERY_FLAG_SET(QUERY_IS_PROTEIN) : this->QUERY_FLAG_CLEAR(QUERY_IS_PROTEIN);
-    _seq_length = calc_seq_length(seq,is_protein);
-    if (!seq.empty() && seq[seq.length()-1] == '\n') {
-        seq.pop_back();
+    if (is_protein) {
+        _sequence_p.pack(begin, end, true);
+        length_ref() = _sequence_p.length() * 3;
+    } else {
+        _sequence_n.pack(begin, end, false);
+        length_ref() = _sequence_n.length();
     }
-    is_protein ? _sequence_p = seq : _sequence_n = seq;
-}
-
-unsigned long QuerySequence::calc_seq_length(std::string &seq,bool protein) {
-    std::string sub = seq.substr(seq.find("\n")+1);
-    long line_chars = std::count(sub.begin(),sub.end(),'\n');
-    unsigned long seq_len = sub.length() - line_chars;
-    if (protein) seq_len *= 3;
-    return seq_len;
 }
 
 /* std::ostream& operator<<(std::ostream &ostream, const QuerySequence &query) {
@@ -102,20 +114,46 @@ const std::string &QuerySequence::getFrame() const {
     return _frame;
 }
 
+const std::string &QuerySequence::get_seq_id() const {
+    return _seq_id;
+}
+
+uint32 QuerySequence::get_query_id() const {
+    return _query_id;
+}
+
+void QuerySequence::set_query_id(uint32 query_id, QueryStore *store) {
+    _query_id = query_id;
+    _pStore   = store;
+}
+
+uint16 QuerySequence::get_query_flags() const {
+    return _pStore != nullptr ? _pStore->get_flags(_query_id) : _query_flags;
+}
+
+// Flags and length live in the QueryStore columns after the sequence is added
+uint16& QuerySequence::flags_ref() {
+    return _pStore != nullptr ? _pStore->flags(_query_id) : _query_flags;
+}
+
+uint64& QuerySequence::length_ref() {
+    return _pStore != nullptr ? _pStore->length(_query_id) : _seq_length;
+}
+
 void QuerySequence::setFrame(const std::string &frame) {
     QuerySequence::_frame = frame;
 }
 
 void QuerySequence::setSeq_length(unsigned long seq_length) {
-    QuerySequence::_seq_length = seq_length;
+    length_ref() = seq_length;
 }
 
 const std::string &QuerySequence::get_species() const {
-    return _sim_search_alignment_data->results->species;
+    return SYMBOL_TABLE.get(_sim_search_alignment_data.results->species);
 }
 
 const std::string &QuerySequence::get_contam_type() const {
-    return _sim_search_alignment_data->results->contam_type;
+    return SYMBOL_TABLE.get(_sim_search_alignment_data.results->contam_type);
 }
 
 
@@ -128,33 +166,159 @@ void QuerySequence::set_eggnog_results(const EggnogResults &eggnogResults) {
 void QuerySequence::init_sequence() {
     _seq_length = 0;
     _fpkm = 0;
+    _query_id = QueryStore::QUERY_ID_NONE;
+    _pStore   = nullptr;
 
-    _sim_search_alignment_data = new SimSearchAlignmentData();
+    _sim_search_alignment_data = SimSearchAlignmentData();
     _eggnog_results     = {};
     _interpro_results   = {};
 
     _frame = "";
-    _sequence_p = "";
-    _sequence_n = "";
 
     _query_flags = 0;
     QUERY_FLAG_SET(QUERY_FRAME_KEPT);
     QUERY_FLAG_SET(QUERY_EXPRESSION_KEPT);
 }
 
-const std::string &QuerySequence::get_sequence() const {
-    if (_sequence_n.empty()) return _sequence_p;
-    return _sequence_n;
+FastaView QuerySequence::get_sequence() const {
+    if (_sequence_n.empty()) return get_sequence_p();
+    return get_sequence_n();
+}
+
+// Similarity search columns, shared by alignments and their parent queries
+// Numeric fields are only formatted here, when a row is actually written
+template<std::string SimSearchResults::*field>
+static void write_sim_search_column(std::ostream &stream, const SimSearchResults &results) {
+    stream << results.*field;
+}
+
+template<SymbolTable::symbol_t SimSearchResults::*field>
+static void write_sim_search_symbol(std::ostream &stream, const SimSearchResults &results) {
+    stream << SYMBOL_TABLE.get(results.*field);
+}
+
+template<bool SimSearchResults::*field>
+static void write_sim_search_flag(std::ostream &stream, const SimSearchResults &results) {
+    stream << (results.*field ? "Yes" : "No");
+}
+
+template<uint32 SimSearchResults::*field>
+static void write_sim_search_count(std::ostream &stream, const SimSearchResults &results) {
+    stream << results.*field;
+}
+
+static void write_sim_search_pident(std::ostream &stream, const SimSearchResults &results) {
+    std::ios::fmtflags flags = stream.flags();
+    std::streamsize precision = stream.precision(results.pident_precision);
+    stream << std::fixed << results.pident;
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+static void write_sim_search_e_val(std::ostream &stream, const SimSearchResults &results) {
+    stream << float_to_sci(results.e_val_raw, 2);
+}
+
+static void write_sim_search_coverage(std::ostream &stream, const SimSearchResults &results) {
+    stream << float_to_string(results.coverage_raw);
+}
+
+static constexpr OutputColumn<SimSearchResults> SIM_SEARCH_COLUMNS[] = {
+        {&ENTAP_EXECUTE::HEADER_QUERY           , &write_sim_search_column<&SimSearchResults::qseqid>},
+        {&ENTAP_EXECUTE::HEADER_SUBJECT         , &write_sim_search_column<&SimSearchResults::sseqid>},
+        {&ENTAP_EXECUTE::HEADER_PERCENT         , &write_sim_search_pident},
+        {&ENTAP_EXECUTE::HEADER_ALIGN_LEN       , &write_sim_search_count<&SimSearchResults::length>},
+        {&ENTAP_EXECUTE::HEADER_MISMATCH        , &write_sim_search_count<&SimSearchResults::mismatch>},
+        {&ENTAP_EXECUTE::HEADER_GAP_OPEN        , &write_sim_search_count<&SimSearchResults::gapopen>},
+        {&ENTAP_EXECUTE::HEADER_QUERY_E         , &write_sim_search_count<&SimSearchResults::qend>},
+        {&ENTAP_EXECUTE::HEADER_QUERY_S         , &write_sim_search_count<&SimSearchResults::qstart>},
+        {&ENTAP_EXECUTE::HEADER_SUBJ_S          , &write_sim_search_count<&SimSearchResults::sstart>},
+        {&ENTAP_EXECUTE::HEADER_SUBJ_E          , &write_sim_search_count<&SimSearchResults::send>},
+        {&ENTAP_EXECUTE::HEADER_E_VAL           , &write_sim_search_e_val},
+        {&ENTAP_EXECUTE::HEADER_COVERAGE        , &write_sim_search_coverage},
+        {&ENTAP_EXECUTE::HEADER_TITLE           , &write_sim_search_column<&SimSearchResults::stitle>},
+        {&ENTAP_EXECUTE::HEADER_SPECIES         , &write_sim_search_symbol<&SimSearchResults::species>},
+        {&ENTAP_EXECUTE::HEADER_DATABASE        , &write_sim_search_symbol<&SimSearchResults::database_path>},
+        {&ENTAP_EXECUTE::HEADER_CONTAM          , &write_sim_search_flag<&SimSearchResults::contaminant>},
+        {&ENTAP_EXECUTE::HEADER_INFORM          , &write_sim_search_flag<&SimSearchResults::is_informative>}
+};
+
+template<std::string QuerySequence::EggnogResults::*field>
+void QuerySequence::write_eggnog_column(std::ostream &stream, const QuerySequence &query) {
+    stream << query._eggnog_results.*field;
+}
+
+template<std::string QuerySequence::InterProResults::*field>
+void QuerySequence::write_interpro_column(std::ostream &stream, const QuerySequence &query) {
+    stream << query._interpro_results.*field;
+}
+
+void QuerySequence::write_seq_id_column(std::ostream &stream, const QuerySequence &query) {
+    stream << query._seq_id;
+}
+
+void QuerySequence::write_frame_column(std::ostream &stream, const QuerySequence &query) {
+    stream << query._frame;
+}
+
+constexpr uint32 QuerySequence::RETAIN_ALL;
+
+constexpr OutputColumn<QuerySequence> QuerySequence::OUTPUT_COLUMNS[] = {
+        {&ENTAP_EXECUTE::HEADER_QUERY           , &QuerySequence::write_seq_id_column},
+        {&ENTAP_EXECUTE::HEADER_FRAME           , &QuerySequence::write_frame_column},
+        {&ENTAP_EXECUTE::HEADER_SEED_ORTH       , &QuerySequence::write_eggnog_column<&EggnogResults::seed_ortholog>},
+        {&ENTAP_EXECUTE::HEADER_SEED_EVAL       , &QuerySequence::write_eggnog_column<&EggnogResults::seed_evalue>},
+        {&ENTAP_EXECUTE::HEADER_SEED_SCORE      , &QuerySequence::write_eggnog_column<&EggnogResults::seed_score>},
+        {&ENTAP_EXECUTE::HEADER_PRED_GENE       , &QuerySequence::write_eggnog_column<&EggnogResults::predicted_gene>},
+        {&ENTAP_EXECUTE::HEADER_TAX_SCOPE       , &QuerySequence::write_eggnog_column<&EggnogResults::tax_scope_readable>},
+        {&ENTAP_EXECUTE::HEADER_EGG_OGS         , &QuerySequence::write_eggnog_column<&EggnogResults::ogs>},
+        {&ENTAP_EXECUTE::HEADER_EGG_DESC        , &QuerySequence::write_eggnog_column<&EggnogResults::description>},
+        {&ENTAP_EXECUTE::HEADER_EGG_KEGG        , &QuerySequence::write_eggnog_column<&EggnogResults::sql_kegg>},
+        {&ENTAP_EXECUTE::HEADER_EGG_PROTEIN     , &QuerySequence::write_eggnog_column<&EggnogResults::protein_domains>},
+        {&ENTAP_EXECUTE::HEADER_INTER_EVAL      , &QuerySequence::write_interpro_column<&InterProResults::e_value>},
+        {&ENTAP_EXECUTE::HEADER_INTER_INTERPRO  , &QuerySequence::write_interpro_column<&InterProResults::interpro_desc_id>},
+        {&ENTAP_EXECUTE::HEADER_INTER_DATA_TERM , &QuerySequence::write_interpro_column<&InterProResults::database_desc_id>},
+        {&ENTAP_EXECUTE::HEADER_INTER_DATA_TYPE , &QuerySequence::write_interpro_column<&InterProResults::database_type>},
+        {&ENTAP_EXECUTE::HEADER_INTER_PATHWAY   , &QuerySequence::write_interpro_column<&InterProResults::pathways>}
+};
+
+/**
+ * ======================================================================
+ * Function void QuerySequence::write_column(std::ostream &stream,
+ *                                           const std::string *header) const
+ *
+ * Description          - Writes a single output column for this query
+ *                      - Similarity search columns are taken from the
+ *                        best hit and left empty if no hit was found
+ *
+ * Notes                - Unknown headers are left empty
+ *
+ * @param stream        - Stream to write column to
+ * @param header        - Header constant from ENTAP_EXECUTE
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void QuerySequence::write_column(std::ostream &stream, const std::string *header) const {
+    const OutputColumn<QuerySequence> *column = find_output_column(OUTPUT_COLUMNS, header);
+    if (column != nullptr) {
+        column->write(stream, *this);
+        return;
+    }
+    if ((get_query_flags() & QUERY_BLAST_HIT) == 0 || _sim_search_alignment_data.results == nullptr) return;
+    const OutputColumn<SimSearchResults> *sim_column = find_output_column(SIM_SEARCH_COLUMNS, header);
+    if (sim_column != nullptr) {
+        sim_column->write(stream, *_sim_search_alignment_data.results);
+    }
 }
 
 std::string QuerySequence::print_tsv(const std::vector<const std::string*>& headers) {
     std::stringstream ss;
 
-    // Fix, shouldn't be initialized here
-    init_header();
-
     for (const std::string *header : headers) {
-        ss << *OUTPUT_MAP[header] << "\t";
+        write_column(ss, header);
+        ss << "\t";
     }
     return ss.str();
 }
@@ -177,7 +341,6 @@ std::string QuerySequence::print_tsv(const std::vector<const std::string*>& head
  * =====================================================================
  */
 std::string QuerySequence::print_tsv(std::vector<const std::string*>& headers, short lvl) {
-    init_header();
     std::stringstream stream;
     go_format_t go_terms;
 
@@ -223,11 +386,8 @@ std::string QuerySequence::print_tsv(std::vector<const std::string*>& headers, s
             }
             stream<<'\t';
         } else {
-            if (OUTPUT_MAP[header] == nullptr) {
-                stream << "" << "\t";
-            } else {
-                stream << *OUTPUT_MAP[header] << "\t";
-            }
+            write_column(stream, header);
+            stream << "\t";
         }
     }
     // free memory in case it gets set later (unlikely)
@@ -239,63 +399,6 @@ void QuerySequence::set_fpkm(float _fpkm) {
 }
 
 
-void QuerySequence::init_header() {
-
-    OUTPUT_MAP = {
-            {&ENTAP_EXECUTE::HEADER_QUERY           , &_seq_id},
-            {&ENTAP_EXECUTE::HEADER_SUBJECT         , &_sim_search_alignment_data->results->sseqid},
-            {&ENTAP_EXECUTE::HEADER_PERCENT         , &_sim_search_alignment_data->results->pident},
-            {&ENTAP_EXECUTE::HEADER_ALIGN_LEN       , &_sim_search_alignment_data->results->length},
-            {&ENTAP_EXECUTE::HEADER_MISMATCH        , &_sim_search_alignment_data->results->mismatch},
-            {&ENTAP_EXECUTE::HEADER_GAP_OPEN        , &_sim_search_alignment_data->results->gapopen},
-            {&ENTAP_EXECUTE::HEADER_QUERY_E         , &_sim_search_alignment_data->results->qend},
-            {&ENTAP_EXECUTE::HEADER_QUERY_S         , &_sim_search_alignment_data->results->qstart},
-            {&ENTAP_EXECUTE::HEADER_SUBJ_S          , &_sim_search_alignment_data->results->sstart},
-            {&ENTAP_EXECUTE::HEADER_SUBJ_E          , &_sim_search_alignment_data->results->send},
-            {&ENTAP_EXECUTE::HEADER_E_VAL           , &_sim_search_alignment_data->results->e_val},
-            {&ENTAP_EXECUTE::HEADER_COVERAGE        , &_sim_search_alignment_data->results->coverage},
-            {&ENTAP_EXECUTE::HEADER_TITLE           , &_sim_search_alignment_data->results->stitle},
-            {&ENTAP_EXECUTE::HEADER_SPECIES         , &_sim_search_alignment_data->results->species},
-            {&ENTAP_EXECUTE::HEADER_DATABASE        , &_sim_search_alignment_data->results->database_path},
-            {&ENTAP_EXECUTE::HEADER_FRAME           , &_frame},
-            {&ENTAP_EXECUTE::HEADER_CONTAM          , &_sim_search_alignment_data->results->yes_no_contam},
-            {&ENTAP_EXECUTE::HEADER_INFORM          , &_sim_search_alignment_data->results->yes_no_inform},
-            {&ENTAP_EXECUTE::HEADER_SEED_ORTH       , &_eggnog_results.seed_ortholog},
-            {&ENTAP_EXECUTE::HEADER_SEED_EVAL       , &_eggnog_results.seed_evalue},
-            {&ENTAP_EXECUTE::HEADER_SEED_SCORE      , &_eggnog_results.seed_score},
-            {&ENTAP_EXECUTE::HEADER_PRED_GENE       , &_eggnog_results.predicted_gene},
-            {&ENTAP_EXECUTE::HEADER_TAX_SCOPE       , &_eggnog_results.tax_scope_readable},
-            {&ENTAP_EXECUTE::HEADER_EGG_OGS         , &_eggnog_results.ogs},
-            {&ENTAP_EXECUTE::HEADER_EGG_DESC        , &_eggnog_results.description},
-            {&ENTAP_EXECUTE::HEADER_EGG_KEGG        , &_eggnog_results.sql_kegg} ,
-            {&ENTAP_EXECUTE::HEADER_EGG_PROTEIN     , &_eggnog_results.protein_domains},
-            {&ENTAP_EXECUTE::HEADER_INTER_EVAL      , &_interpro_results.e_value},
-            {&ENTAP_EXECUTE::HEADER_INTER_INTERPRO  , &_interpro_results.interpro_desc_id},
-            {&ENTAP_EXECUTE::HEADER_INTER_DATA_TERM , &_interpro_results.database_desc_id},
-            {&ENTAP_EXECUTE::HEADER_INTER_DATA_TYPE , &_interpro_results.database_type},
-            {&ENTAP_EXECUTE::HEADER_INTER_PATHWAY   , &_interpro_results.pathways}
-    };
-
-    if (!QUERY_FLAG_GET(QUERY_BLAST_HIT)) {
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_SUBJECT] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_PERCENT] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_ALIGN_LEN] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_MISMATCH] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_GAP_OPEN] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_QUERY_E] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_QUERY_S] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_SUBJ_S] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_SUBJ_E] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_E_VAL] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_COVERAGE] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_TITLE] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_SPECIES] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_DATABASE] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_CONTAM] = nullptr;
-        OUTPUT_MAP[&ENTAP_EXECUTE::HEADER_INFORM] = nullptr;
-    }
-}
-
 void QuerySequence::set_interpro_results(std::string& eval, std::string& database_info, std::string& data,
                                          std::string& interpro_info, std::string& pathway,
                                          go_format_t& go_terms) {
@@ -314,58 +417,31 @@ bool QuerySequence::is_kept() {
 }
 
 bool QuerySequence::QUERY_FLAG_GET(QUERY_FLAGS flag) {
-    return (_query_flags & flag) != 0;
+    return (get_query_flags() & flag) != 0;
 }
 
 void QuerySequence::QUERY_FLAG_SET(QUERY_FLAGS flag) {
-    _query_flags |= flag;
+    flags_ref() |= flag;
 }
 
 void QuerySequence::QUERY_FLAG_CLEAR(QUERY_FLAGS flag) {
-    _query_flags &= ~flag;
+    flags_ref() &= ~flag;
 }
 
 
+// Alignments are owned by the QueryData alignment pool
 QuerySequence::~QuerySequence() {
-    for (auto &pair : (_sim_search_alignment_data->alignments)) {
-        // first: database, second: pair of best hit to all hits (vector)
-        for (QueryAlignment *alignment : pair.second.second) {
-            // cycle through alignments and update the best hit
-            delete(alignment);
-        }
-    }
-    delete _sim_search_alignment_data;
 }
 
 // **********************************************************************
 
 
-SimSearchAlignment::SimSearchAlignment(QuerySequence * a, uint16 b, std::string c, SimSearchResults d, std::string &lineage)
+SimSearchAlignment::SimSearchAlignment(QuerySequence * a, uint16 b, std::string c, SimSearchResults d)
         : QueryAlignment(a,b,c){
     this->_sim_search_results = d;
     this->_best_hit = false;
-    this->set_tax_score(lineage);
-
-    this->OUTPUT_MAP = {
-            {&ENTAP_EXECUTE::HEADER_QUERY           , &_sim_search_results.qseqid},
-            {&ENTAP_EXECUTE::HEADER_SUBJECT         , &_sim_search_results.sseqid},
-            {&ENTAP_EXECUTE::HEADER_PERCENT         , &_sim_search_results.pident},
-            {&ENTAP_EXECUTE::HEADER_ALIGN_LEN       , &_sim_search_results.length},
-            {&ENTAP_EXECUTE::HEADER_MISMATCH        , &_sim_search_results.mismatch},
-            {&ENTAP_EXECUTE::HEADER_GAP_OPEN        , &_sim_search_results.gapopen},
-            {&ENTAP_EXECUTE::HEADER_QUERY_E         , &_sim_search_results.qend},
-            {&ENTAP_EXECUTE::HEADER_QUERY_S         , &_sim_search_results.qstart},
-            {&ENTAP_EXECUTE::HEADER_SUBJ_S          , &_sim_search_results.sstart},
-            {&ENTAP_EXECUTE::HEADER_SUBJ_E          , &_sim_search_results.send},
-            {&ENTAP_EXECUTE::HEADER_E_VAL           , &_sim_search_results.e_val},
-            {&ENTAP_EXECUTE::HEADER_COVERAGE        , &_sim_search_results.coverage},
-            {&ENTAP_EXECUTE::HEADER_TITLE           , &_sim_search_results.stitle},
-            {&ENTAP_EXECUTE::HEADER_SPECIES         , &_sim_search_results.species},
-            {&ENTAP_EXECUTE::HEADER_DATABASE        , &_sim_search_results.database_path},
-            {&ENTAP_EXECUTE::HEADER_FRAME           , &_frame},
-            {&ENTAP_EXECUTE::HEADER_CONTAM          , &_sim_search_results.yes_no_contam},
-            {&ENTAP_EXECUTE::HEADER_INFORM          , &_sim_search_results.yes_no_inform}
-    };
+    this->_sim_search_results.e_val_log = log10(d.e_val_raw == 0 ? E_VAL_MIN : d.e_val_raw);
+    this->set_tax_score();
 }
 
 SimSearchResults *SimSearchAlignment::get_results() {
@@ -376,15 +452,14 @@ bool SimSearchAlignment::operator>(const SimSearchAlignment &alignment) {
 
     fp64 eval1 = this->_sim_search_results.e_val_raw;
     fp64 eval2 = alignment._sim_search_results.e_val_raw;
-    // Avoid error on taking log
-    if (eval1 == 0) eval1 = 1E-200;
-    if (eval2 == 0) eval2 = 1E-200;
+    if (eval1 == 0) eval1 = E_VAL_MIN;
+    if (eval2 == 0) eval2 = E_VAL_MIN;
     fp64 cov1 = this->_sim_search_results.coverage_raw;
     fp64 cov2 = alignment._sim_search_results.coverage_raw;
     fp64 coverage_dif = fabs(cov1 - cov2);
     if (!this->_best_hit) {
         // For hits of the same database "better hit"
-        if (fabs(log10(eval1) - log10(eval2)) < E_VAL_DIF) {
+        if (fabs(this->_sim_search_results.e_val_log - alignment._sim_search_results.e_val_log) < E_VAL_DIF) {
             if (coverage_dif > COV_DIF) {
                 return cov1 > cov2;
             }
@@ -414,11 +489,18 @@ QueryAlignment::QueryAlignment(QuerySequence *parent, uint16 flag, std::string d
     _frame = parent->getFrame();
 }
 
-std::string QueryAlignment::print_tsv(const std::vector<const std::string *> &headers)  {
+std::string SimSearchAlignment::print_tsv(const std::vector<const std::string *> &headers)  {
     std::stringstream stream;
+    const OutputColumn<SimSearchResults> *column;
 
     for (const std::string *header : headers) {
-        stream << *OUTPUT_MAP[header] << "\t";
+        if (header == &ENTAP_EXECUTE::HEADER_FRAME) {
+            stream << _frame;
+        } else {
+            column = find_output_column(SIM_SEARCH_COLUMNS, header);
+            if (column != nullptr) column->write(stream, _sim_search_results);
+        }
+        stream << "\t";
     }
     return stream.str();
 }
@@ -426,11 +508,10 @@ std::string QueryAlignment::print_tsv(const std::vector<const std::string *> &he
 bool QuerySequence::hit_database(std::string &database, ExecuteStates state) {
     switch (state) {
         case SIMILARITY_SEARCH:
-            if (_sim_search_alignment_data == nullptr) return false;
-            if (_sim_search_alignment_data->alignments.empty()) return false;
+            if (_sim_search_alignment_data.alignments.empty()) return false;
             if (!database.empty()) {
-                return (_sim_search_alignment_data->alignments.find(database) !=\
-                    _sim_search_alignment_data->alignments.end());
+                return (_sim_search_alignment_data.alignments.find(database) !=\
+                    _sim_search_alignment_data.alignments.end());
             } else {
                 return QUERY_FLAG_GET(QUERY_BLAST_HIT);
             }
@@ -442,8 +523,11 @@ bool QuerySequence::hit_database(std::string &database, ExecuteStates state) {
 
 QuerySequence::align_database_hits_t* QuerySequence::get_database_hits(std::string &database, ExecuteStates state) {
     switch (state) {
-        case SIMILARITY_SEARCH:
-            return &this->_sim_search_alignment_data->alignments[database];
+        case SIMILARITY_SEARCH: {
+            alignment_database_map_t::iterator it = this->_sim_search_alignment_data.alignments.find(database);
+            if (it == this->_sim_search_alignment_data.alignments.end()) return nullptr;
+            return &it->second;
+        }
         default:
             return nullptr;
     }
@@ -452,13 +536,13 @@ QuerySequence::align_database_hits_t* QuerySequence::get_database_hits(std::stri
 void QuerySequence::update_query_flags(ExecuteStates state) {
     switch (state) {
         case SIMILARITY_SEARCH:
-            _sim_search_alignment_data-> results = _sim_search_alignment_data->best_hit->get_results();
-            if (this->_sim_search_alignment_data->results->is_informative) {
+            _sim_search_alignment_data.results = _sim_search_alignment_data.best_hit->get_results();
+            if (this->_sim_search_alignment_data.results->is_informative) {
                 QUERY_FLAG_SET(QUERY_INFORMATIVE);
             } else {
                 QUERY_FLAG_CLEAR(QUERY_INFORMATIVE);
             }
-            if (this->_sim_search_alignment_data->results->contaminant) {
+            if (this->_sim_search_alignment_data.results->contaminant) {
                 QUERY_FLAG_SET(QUERY_CONTAMINANT);
             } else {
                 QUERY_FLAG_CLEAR(QUERY_CONTAMINANT);
@@ -476,32 +560,21 @@ bool QuerySequence::isContaminant() {
 
 /**
  * ======================================================================
- * Function void QuerySequence::set_tax_score(std::string input_lineage)
+ * Function void QuerySequence::set_tax_score()
  *
  * Description          - Sets tax score based on informativeness and
  *                        lineage
  *
- * Notes                - None
- *
- * @param lineage       - Lineage input from  user
+ * Notes                - Results tax score is preset to the number of
+ *                        ancestors shared with the target species
  *
  * @return              - None
  *
  * =====================================================================
  */
-void SimSearchAlignment::set_tax_score(std::string &input_lineage) {
-    float tax_score = 0;
-    std::string lineage = this->_sim_search_results.lineage;
-    std::remove_if(lineage.begin(),lineage.end(), ::isspace);
-    std::remove_if(input_lineage.begin(),input_lineage.end(), ::isspace);
-
-    std::string temp;
-    size_t p = 0;std::string del = ";";
-    while ((p = lineage.find(";"))!=std::string::npos) {
-        temp = lineage.substr(0,p);
-        if (input_lineage.find(temp)!=std::string::npos) tax_score++;
-        lineage.erase(0,p+del.length());
-    }
+void SimSearchAlignment::set_tax_score() {
+    float tax_score = this->_sim_search_results.tax_score;
+
     if (tax_score == 0) {
         if(this->_sim_search_results.is_informative) tax_score += INFORM_ADD;
     } else {
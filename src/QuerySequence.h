@@ -32,41 +32,59 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include "PackedSequence.h"
+#include "ObjectPool.h"
+#include "SymbolTable.h"
 #include "Ontology.h"
 #include "database/SQLDatabaseHelper.h"
 #include "EntapExecute.h"
 
 
 class QuerySequence;
+class QueryStore;
+
 struct SimSearchResults {
-        std::string                       length;
-        std::string                       mismatch;
-        std::string                       gapopen;
-        std::string                       qstart;
-        std::string                       qend;
-        std::string                       sstart;
-        std::string                       send;
-        std::string                       pident;
-        std::string                       bit_score;
-        std::string                       e_val;
-        std::string                       coverage;
-        std::string                       database_path;
         std::string                       qseqid;
         std::string                       sseqid;
         std::string                       stitle;
-        std::string                       species;
-        std::string                       contam_type;
-        std::string                       lineage;
-        std::string                       yes_no_contam; // just for convenience
-        std::string                       yes_no_inform;
-        fp32                              tax_score;     // taxonomic score, may be based on parent
+        SymbolTable::symbol_t             database_path; // Handles into SYMBOL_TABLE
+        SymbolTable::symbol_t             species;
+        SymbolTable::symbol_t             contam_type;
+        SymbolTable::symbol_t             lineage;
         fp64                              e_val_raw;
+        fp64                              e_val_log;     // log10 of e-value, set by alignment
         fp64                              coverage_raw;
+        fp32                              pident;
+        fp32                              bit_score;
+        fp32                              tax_score;     // taxonomic score, may be based on parent
+        uint32                            length;
+        uint32                            mismatch;
+        uint32                            gapopen;
+        uint32                            qstart;
+        uint32                            qend;
+        uint32                            sstart;
+        uint32                            send;
+        uint8                             pident_precision;  // decimals DIAMOND printed
         bool                              contaminant;
         bool                              is_informative;
     };
 // Taken from best hit
 
+// Static output column: header constant to formatter, shared by every object of type T
+template<class T>
+struct OutputColumn {
+    const std::string *header;
+    void             (*write)(std::ostream&, const T&);
+};
+
+template<class T, size_t N>
+const OutputColumn<T> *find_output_column(const OutputColumn<T> (&columns)[N], const std::string *header) {
+    for (const OutputColumn<T> &column : columns) {
+        if (column.header == header) return &column;
+    }
+    return nullptr;
+}
+
 class QueryAlignment {
 
 public:
@@ -79,7 +97,6 @@ protected:
     uint16           _software_flag;
     std::string      _database;
     std::string      _frame;
-    std::map<const std::string*, std::string*> OUTPUT_MAP;
 };
 
 class SimSearchAlignment : public QueryAlignment{
@@ -87,14 +104,13 @@ class SimSearchAlignment : public QueryAlignment{
 public:
     bool operator>(const SimSearchAlignment&);
     bool operator<(const SimSearchAlignment&query) {return !(*this > query);};
-    SimSearchAlignment(QuerySequence*, uint16, std::string, SimSearchResults,
-                       std::string&);
+    SimSearchAlignment(QuerySequence*, uint16, std::string, SimSearchResults);
     SimSearchResults* get_results();
-    std::string print_tsv(const std::vector<const std::string*>&header){ return QueryAlignment::print_tsv(header); }
+    std::string print_tsv(const std::vector<const std::string*>&);
     void set_best_hit(bool a){this->_best_hit = a;}
 
 private:
-    void set_tax_score(std::string&);
+    void set_tax_score();
 
     SimSearchResults    _sim_search_results;
     bool                _best_hit;
@@ -104,15 +120,22 @@ protected:
     static constexpr uint8 COV_DIF       = 5;
     static constexpr uint8 INFORM_ADD    = 3;
     static constexpr fp32 INFORM_FACTOR  = 1.2;
+    static constexpr fp64 E_VAL_MIN      = 1E-200;  // Replaces 0 to avoid error on taking log
 };
 
 class QuerySequence {
 public:
 
     // Avoid cluttering global with the following defs
-    typedef std::pair<QueryAlignment*,std::vector<QueryAlignment*>> align_database_hits_t;
+    struct align_database_hits_t {
+        QueryAlignment*              best_hit;
+        std::vector<QueryAlignment*> hits;          // Retained hits, in order added
+        uint32                       hit_count;     // All hits added, retained or not
+    };
     typedef std::unordered_map<std::string,align_database_hits_t> alignment_database_map_t;
 
+    static constexpr uint32 RETAIN_ALL = 0;
+
     typedef enum {
 
         QUERY_BLAST_HIT         = (1 << 0),
@@ -169,7 +192,7 @@ public:
     };
 
     QuerySequence();
-    QuerySequence(bool, std::string, std::string);
+    QuerySequence(bool, const char*, const char*, const std::string&);
     ~QuerySequence();
     void setSequence(std::string&);
     // TODO switch to map results
@@ -179,19 +202,22 @@ public:
     std::string print_tsv(const std::vector<const std::string*>&);
     std::string print_tsv(std::vector<const std::string*>& , short);
 
-    void init_header();
     const std::string &get_contam_type() const;
     void setSeq_length(unsigned long seq_length);
     void setFrame(const std::string &frame);
 
     unsigned long getSeq_length() const;
     const std::string &getFrame() const;
+    const std::string &get_seq_id() const;
+    uint32 get_query_id() const;
+    void set_query_id(uint32, QueryStore*);
+    uint16 get_query_flags() const;
     const std::string &get_species() const;
-    const std::string &get_sequence_p() const;
+    FastaView get_sequence_p() const;
     void set_sequence_p(const std::string &_sequence_p);
-    const std::string &get_sequence_n() const;
+    FastaView get_sequence_n() const;
     void set_sequence_n(const std::string &_sequence_n);
-    const std::string &get_sequence() const;
+    FastaView get_sequence() const;
     void set_fpkm(float _fpkm);
     bool is_kept();
     bool QUERY_FLAG_GET(QUERY_FLAGS);
@@ -207,9 +233,12 @@ public:
         switch (state) {
             case SIMILARITY_SEARCH:
                 if (database.empty()) {
-                    return static_cast<T*>(this->_sim_search_alignment_data->best_hit);
+                    return static_cast<T*>(this->_sim_search_alignment_data.best_hit);
                 }else {
-                    return static_cast<T*>(this->_sim_search_alignment_data->alignments[database].first);
+                    // find (not operator[]) so concurrent readers are safe
+                    alignment_database_map_t::iterator it = this->_sim_search_alignment_data.alignments.find(database);
+                    if (it == this->_sim_search_alignment_data.alignments.end()) return nullptr;
+                    return static_cast<T*>(it->second.best_hit);
                 }
             default:
                 return nullptr;
@@ -222,78 +251,130 @@ public:
         switch (state) {
             case SIMILARITY_SEARCH:
                 if (database.empty()) {
-                    this->_sim_search_alignment_data->best_hit = static_cast<T*>(alignment);
+                    this->_sim_search_alignment_data.best_hit = static_cast<T*>(alignment);
                 }else {
-                    this->_sim_search_alignment_data->alignments[database].first = static_cast<T*>(alignment);
+                    this->_sim_search_alignment_data.alignments[database].best_hit = static_cast<T*>(alignment);
                 }
             default:
                 return nullptr;
         }
     }
 
+    // Alignments are retained per database up to this count (RETAIN_ALL keeps every hit)
     template<class T, class U>
     void add_alignment(ExecuteStates state, uint16 software, U &results, std::string &database,
-                                      std::string &lineage) {
-        // Create new alignment object
-        T *new_alignment = (new T(this, software, database, results, lineage));
+                                      ObjectPool<T> &pool, uint32 retain = RETAIN_ALL) {
+        // Create new alignment object, owned by pool
+        T *new_alignment = pool.create(this, software, database, results);
         // Update vector containing all alignments
         switch (state) {
-            case SIMILARITY_SEARCH:
+            case SIMILARITY_SEARCH: {
                 QUERY_FLAG_SET(QUERY_BLAST_HIT);
-                if (this->_sim_search_alignment_data->alignments.find(database) ==
-                    this->_sim_search_alignment_data->alignments.end()) {
-                    // database not found, make new entry for database
-                    std::vector<QueryAlignment*> vect = {new_alignment};
-                    this->_sim_search_alignment_data->alignments.emplace(database,
-                            std::make_pair(nullptr, vect));
-                }else {
-                    // database found, just add to vector containing all hits
-                    this->_sim_search_alignment_data->alignments[database].second.push_back(
-                            new_alignment
-                    );
+                // New database entries start with no hits
+                align_database_hits_t &database_data = this->_sim_search_alignment_data.alignments[database];
+                database_data.hits.push_back(new_alignment);
+                database_data.hit_count++;
+                update_best_hit<T>(state, database_data, new_alignment);
+                if (retain != RETAIN_ALL && database_data.hits.size() > retain) {
+                    drop_worst_hit<T>(database_data, pool);
                 }
                 break;
+            }
             default:
                 return;
         }
-        update_best_hit<T>(state, database);
     }
 
+    // Compares only the new alignment against the current best hits
     template<class T>
-    void update_best_hit(ExecuteStates state, std::string &database) {
-        align_database_hits_t *database_data = get_database_hits(database, state);
-        // first: database, second: pair of best hit to all hits (vector)
-        for (auto *temp : database_data->second) {
-            T* alignment = static_cast<T*>(temp);
-            T* database_best_hit = get_best_hit_alignment<T>(state, database);
-            // cycle through alignments and update the best hit
-            if (database_best_hit == nullptr || *alignment > *database_best_hit) {
-                // Update best hit for database
-                set_best_hit_alignment<T>(state,database,temp);
-                // Update overall best hit for parent
-                T* best_overall_hit = get_best_hit_alignment<T>(state, "");
-                switch (state) {
-                    case SIMILARITY_SEARCH:
-                        // must only compare best overall (between databases) for sim search)=
-                        alignment->set_best_hit(true);
-                        break;
-                    default:
-                        break;
-                }
-                if (best_overall_hit == nullptr || *alignment > *best_overall_hit) {
-                    set_best_hit_alignment<T>(state, "", temp);
-                    // Update parent flags, data...
-                    update_query_flags(state);
+    void update_best_hit(ExecuteStates state, align_database_hits_t &database_data, T *alignment) {
+        T* database_best_hit = static_cast<T*>(database_data.best_hit);
+        if (database_best_hit == nullptr || *alignment > *database_best_hit) {
+            // Update best hit for database
+            database_data.best_hit = alignment;
+            // Update overall best hit for parent
+            T* best_overall_hit = get_best_hit_alignment<T>(state, "");
+            switch (state) {
+                case SIMILARITY_SEARCH:
+                    // must only compare best overall (between databases) for sim search)=
+                    alignment->set_best_hit(true);
+                    break;
+                default:
+                    break;
+            }
+            if (best_overall_hit == nullptr || *alignment > *best_overall_hit) {
+                set_best_hit_alignment<T>(state, "", alignment);
+                // Update parent flags, data...
+                update_query_flags(state);
+            }
+            switch (state) {
+                case SIMILARITY_SEARCH:
+                    alignment->set_best_hit(false);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Reselects the overall best hit from database best hits in the given order,
+    // so it does not depend on the order database files were parsed in
+    template<class T>
+    void select_best_hit(ExecuteStates state, const std::vector<std::string> &databases) {
+        T* best_overall_hit = nullptr;
+        switch (state) {
+            case SIMILARITY_SEARCH:
+                for (const std::string &database : databases) {
+                    T* database_best_hit = get_best_hit_alignment<T>(state, database);
+                    if (database_best_hit == nullptr) continue;
+                    database_best_hit->set_best_hit(true);
+                    if (best_overall_hit == nullptr || *database_best_hit > *best_overall_hit) {
+                        best_overall_hit = database_best_hit;
+                    }
+                    database_best_hit->set_best_hit(false);
                 }
-                switch (state) {
-                    case SIMILARITY_SEARCH:
-                        // must only compare best overall (between databases) for sim search)=
-                        alignment->set_best_hit(false);
-                        break;
-                    default:
-                        break;
+                break;
+            default:
+                return;
+        }
+        if (best_overall_hit != nullptr) {
+            set_best_hit_alignment<T>(state, "", best_overall_hit);
+            update_query_flags(state);
+        }
+    }
+
+    // Releases the lowest ranked hit, never the database or overall best hit
+    template<class T>
+    void drop_worst_hit(align_database_hits_t &database_data, ObjectPool<T> &pool) {
+        std::vector<QueryAlignment*>::iterator worst = database_data.hits.end();
+        for (std::vector<QueryAlignment*>::iterator it = database_data.hits.begin();
+             it != database_data.hits.end(); ++it) {
+            if (*it == database_data.best_hit || *it == this->_sim_search_alignment_data.best_hit) continue;
+            if (worst == database_data.hits.end() || *static_cast<T*>(*worst) > *static_cast<T*>(*it)) {
+                worst = it;
+            }
+        }
+        if (worst == database_data.hits.end()) return;
+        T *dropped = static_cast<T*>(*worst);
+        database_data.hits.erase(worst);
+        pool.destroy(dropped);
+    }
+
+    // Releases every hit that is not a database or overall best hit
+    template<class T>
+    void drop_unselected_hits(ObjectPool<T> &pool) {
+        for (alignment_database_map_t::iterator it = this->_sim_search_alignment_data.alignments.begin();
+             it != this->_sim_search_alignment_data.alignments.end(); ++it) {
+            std::vector<QueryAlignment*> &hits = it->second.hits;
+            std::vector<QueryAlignment*>::iterator kept = hits.begin();
+            for (QueryAlignment *hit : hits) {
+                if (hit == it->second.best_hit || hit == this->_sim_search_alignment_data.best_hit) {
+                    *kept++ = hit;
+                } else {
+                    pool.destroy(static_cast<T*>(hit));
                 }
             }
+            hits.erase(kept, hits.end());
         }
     }
 
@@ -302,20 +383,32 @@ public:
 private:
     fp32                              _fpkm;
     uint16                            _query_flags;
+    uint32                            _query_id;    // Dense ID from QueryStore
+    QueryStore                       *_pStore;      // Owns flags and length once added
     std::string                       _seq_id;
-    unsigned long                     _seq_length;
-    std::string                       _sequence_p;
-    std::string                       _sequence_n;
+    uint64                            _seq_length;
+    PackedSequence                    _sequence_p;
+    PackedSequence                    _sequence_n;
     std::string                       _frame;
     EggnogResults                     _eggnog_results;
     InterProResults                   _interpro_results;
-    SimSearchAlignmentData            *_sim_search_alignment_data;  // contains all alignment data
-    std::map<const std::string*, std::string*> OUTPUT_MAP;
+    SimSearchAlignmentData            _sim_search_alignment_data;   // contains all alignment data
+
+    static const OutputColumn<QuerySequence> OUTPUT_COLUMNS[];
+
+    template<std::string EggnogResults::*field>
+    static void write_eggnog_column(std::ostream&, const QuerySequence&);
+    template<std::string InterProResults::*field>
+    static void write_interpro_column(std::ostream&, const QuerySequence&);
+    static void write_seq_id_column(std::ostream&, const QuerySequence&);
+    static void write_frame_column(std::ostream&, const QuerySequence&);
 
     friend std::ostream& operator<<(std::ostream& , const QuerySequence&);
     void init_sequence();
-    unsigned long calc_seq_length(std::string &,bool);
+    void write_column(std::ostream&, const std::string*) const;
     void update_query_flags(ExecuteStates);
+    uint16& flags_ref();
+    uint64& length_ref();
 };
 
 
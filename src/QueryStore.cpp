@@ -0,0 +1,206 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "QueryStore.h"
+#include "QuerySequence.h"
+
+constexpr uint32 QueryStore::QUERY_ID_NONE;
+constexpr uint32 QueryStore::INDEX_EMPTY;
+
+QueryStore::QueryStore() {
+    _index.assign(INDEX_MIN_SIZE, INDEX_EMPTY);
+    _index_mask = INDEX_MIN_SIZE - 1;
+}
+
+
+/**
+ * ======================================================================
+ * Function uint32 QueryStore::add(QuerySequence *sequence, uint64 hash)
+ *
+ * Description          - Adds sequence to store, assigning next dense ID
+ *                      - Hash may be computed ahead of time (ingest threads)
+ *
+ * Notes                - Sequence ID must not change after being added
+ *                      - Flags and length of the sequence move into the
+ *                        store columns
+ *
+ * @param sequence      - Sequence to add
+ * @param hash          - QueryStore::hash of the sequence ID
+ *
+ * @return              - Dense ID, QUERY_ID_NONE if ID is a duplicate
+ *
+ * =====================================================================
+ */
+uint32 QueryStore::add(QuerySequence *sequence, uint64 hash) {
+    const std::string &seq_id = sequence->get_seq_id();
+    uint32             query_id;
+    uint64             slot;
+
+    // Keep load factor at or below one half
+    if ((_sequences.size() + 1) * 2 > _index.size()) rehash(_index.size() * 2);
+
+    for (slot = hash & _index_mask; _index[slot] != INDEX_EMPTY; slot = (slot + 1) & _index_mask) {
+        query_id = _index[slot];
+        if (_hashes[query_id] == hash && *_seq_ids[query_id] == seq_id) return QUERY_ID_NONE;
+    }
+    query_id     = (uint32) _sequences.size();
+    _index[slot] = query_id;
+    _sequences.push_back(sequence);
+    _seq_ids.push_back(&seq_id);
+    _hashes.push_back(hash);
+    _flags.push_back(sequence->get_query_flags());
+    _lengths.push_back(sequence->getSeq_length());
+    sequence->set_query_id(query_id, this);
+    return query_id;
+}
+
+uint32 QueryStore::add(QuerySequence *sequence) {
+    const std::string &seq_id = sequence->get_seq_id();
+    return add(sequence, hash(seq_id.data(), seq_id.size()));
+}
+
+
+/**
+ * ======================================================================
+ * Function uint32 QueryStore::find_id(const char *seq_id, uint64 len)
+ *
+ * Description          - Looks up dense ID of a sequence ID
+ *
+ * Notes                - Does not require a std::string, parsers may pass
+ *                        fields in place
+ *
+ * @param seq_id        - Sequence ID characters
+ * @param len           - Length of sequence ID
+ *
+ * @return              - Dense ID, QUERY_ID_NONE if not found
+ *
+ * =====================================================================
+ */
+uint32 QueryStore::find_id(const char *seq_id, uint64 len) const {
+    uint64 hash_val;
+    uint32 query_id;
+
+    hash_val = hash(seq_id, len);
+    for (uint64 slot = hash_val & _index_mask; _index[slot] != INDEX_EMPTY; slot = (slot + 1) & _index_mask) {
+        query_id = _index[slot];
+        if (_hashes[query_id] == hash_val && _seq_ids[query_id]->size() == len &&
+            _seq_ids[query_id]->compare(0, len, seq_id, len) == 0) {
+            return query_id;
+        }
+    }
+    return QUERY_ID_NONE;
+}
+
+uint32 QueryStore::find_id(const std::string &seq_id) const {
+    return find_id(seq_id.data(), seq_id.size());
+}
+
+QuerySequence* QueryStore::find(const std::string &seq_id) const {
+    uint32 query_id = find_id(seq_id);
+    return query_id == QUERY_ID_NONE ? nullptr : _sequences[query_id];
+}
+
+QuerySequence* QueryStore::at(uint32 query_id) const {
+    return _sequences[query_id];
+}
+
+const std::string& QueryStore::get_seq_id(uint32 query_id) const {
+    return *_seq_ids[query_id];
+}
+
+uint64 QueryStore::get_hash(uint32 query_id) const {
+    return _hashes[query_id];
+}
+
+uint16 QueryStore::get_flags(uint32 query_id) const {
+    return _flags[query_id];
+}
+
+uint16& QueryStore::flags(uint32 query_id) {
+    return _flags[query_id];
+}
+
+uint64 QueryStore::get_length(uint32 query_id) const {
+    return _lengths[query_id];
+}
+
+uint64& QueryStore::length(uint32 query_id) {
+    return _lengths[query_id];
+}
+
+uint32 QueryStore::size() const {
+    return (uint32) _sequences.size();
+}
+
+bool QueryStore::empty() const {
+    return _sequences.empty();
+}
+
+void QueryStore::reserve(uint32 count) {
+    uint64 index_size = INDEX_MIN_SIZE;
+
+    _sequences.reserve(count);
+    _seq_ids.reserve(count);
+    _hashes.reserve(count);
+    _flags.reserve(count);
+    _lengths.reserve(count);
+    while (index_size < (uint64) count * 2) index_size <<= 1;
+    if (index_size > _index.size()) rehash(index_size);
+}
+
+QueryStore::const_iterator QueryStore::begin() const {
+    return _sequences.begin();
+}
+
+QueryStore::const_iterator QueryStore::end() const {
+    return _sequences.end();
+}
+
+// FNV-1a, 64 bit
+uint64 QueryStore::hash(const char *data, uint64 len) {
+    uint64 hash_val = 14695981039346656037ULL;
+
+    for (uint64 i = 0; i < len; i++) {
+        hash_val ^= (uint8) data[i];
+        hash_val *= 1099511628211ULL;
+    }
+    return hash_val;
+}
+
+// Index only holds dense IDs, rebuilt from cached hashes
+void QueryStore::rehash(uint64 index_size) {
+    uint64 slot;
+
+    _index.assign(index_size, INDEX_EMPTY);
+    _index_mask = index_size - 1;
+    for (uint32 query_id = 0; query_id < _sequences.size(); query_id++) {
+        for (slot = _hashes[query_id] & _index_mask; _index[slot] != INDEX_EMPTY;
+             slot = (slot + 1) & _index_mask);
+        _index[slot] = query_id;
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ENTAP_QUERYSTORE_H
+#define ENTAP_QUERYSTORE_H
+
+#include "common.h"
+
+class QuerySequence;
+
+/*
+ * Transcriptome sequences keyed by dense IDs (0..N-1) assigned in input
+ * order. Per sequence fields are kept in parallel vectors and ID strings
+ * are resolved through a single open addressing index (linear probing)
+ * with cached hashes, so whole transcriptome passes are linear scans in
+ * input order.
+ *
+ * Query flags and sequence lengths are owned by the store once a sequence
+ * is added, so passes that only filter or count on them scan these
+ * columns without touching the sequences.
+ */
+class QueryStore {
+
+public:
+    typedef std::vector<QuerySequence*>::const_iterator const_iterator;
+
+    static constexpr uint32 QUERY_ID_NONE = 0xFFFFFFFF;
+
+    QueryStore();
+    uint32 add(QuerySequence*);
+    uint32 add(QuerySequence*, uint64);
+    uint32 find_id(const char*, uint64) const;
+    uint32 find_id(const std::string&) const;
+    QuerySequence* find(const std::string&) const;
+    QuerySequence* at(uint32) const;
+    const std::string& get_seq_id(uint32) const;
+    uint64 get_hash(uint32) const;
+    uint16 get_flags(uint32) const;
+    uint16& flags(uint32);
+    uint64 get_length(uint32) const;
+    uint64& length(uint32);
+    uint32 size() const;
+    bool empty() const;
+    void reserve(uint32);
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    static uint64 hash(const char*, uint64);
+
+private:
+    void rehash(uint64);
+
+    static constexpr uint32 INDEX_EMPTY     = 0xFFFFFFFF;
+    static constexpr uint64 INDEX_MIN_SIZE  = 1024;     // Must be power of 2
+
+    std::vector<QuerySequence*>       _sequences;     // Column: sequence data
+    std::vector<const std::string*>   _seq_ids;       // Column: ID strings (owned by sequence)
+    std::vector<uint64>               _hashes;        // Column: cached ID hashes
+    std::vector<uint16>               _flags;         // Column: QuerySequence::QUERY_FLAGS
+    std::vector<uint64>               _lengths;       // Column: sequence length (nucleotides)
+    std::vector<uint32>               _index;         // Slot -> dense ID
+    uint64                            _index_mask;
+};
+
+
+#endif //ENTAP_QUERYSTORE_H
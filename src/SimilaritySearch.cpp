@@ -28,9 +28,13 @@
 //*********************** Includes *****************************
 #include <boost/range/iterator_range_core.hpp>
 #include <csv.h>
-#include <boost/regex.hpp>
+#include <pstream.h>
 #include <iomanip>
+#include <limits>
+#include <mutex>
+#include <condition_variable>
 #include "SimilaritySearch.h"
+#include "AlignmentRuns.h"
 #include "FileSystem.h"
 #include "ExceptionHandler.h"
 #include "GraphingManager.h"
@@ -40,6 +44,42 @@
 #include "database/EntapDatabase.h"
 //**************************************************************
 
+const std::string SimilaritySearch::UNIPROT_SPECIES_TAG = "OS=";
+const std::string SimilaritySearch::DMND_FAST           = "fast";
+const std::string SimilaritySearch::DMND_SENSITIVE      = "sensitive";
+const std::string SimilaritySearch::DMND_MORE_SENSITIVE = "more-sensitive";
+constexpr uint64 SimilaritySearch::RUN_BUDGET_MIN;
+constexpr uint64 SimilaritySearch::STAGE_BATCH_ROWS;
+constexpr uint64 SimilaritySearch::STAGE_BATCH_SPECIES;
+constexpr uint64 SimilaritySearch::STAGE_QUEUE_BATCHES;
+
+/*
+ * Input buffer that reads from another stream buffer (DIAMOND stdout)
+ * and copies everything it reads to an output stream, so streamed
+ * results are also kept on disk.
+ */
+class TeeStreambuf : public std::streambuf {
+
+public:
+    TeeStreambuf(std::streambuf *source, std::ostream &copy) : _source(source), _copy(copy) {}
+
+protected:
+    int_type underflow() {
+        std::streamsize n = _source->sgetn(_buffer, BUFFER_SIZE);
+        if (n <= 0) return traits_type::eof();
+        _copy.write(_buffer, n);
+        setg(_buffer, _buffer, _buffer + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    static constexpr std::streamsize BUFFER_SIZE = 1 << 16;
+
+    std::streambuf *_source;
+    std::ostream   &_copy;
+    char            _buffer[BUFFER_SIZE];
+};
+
 
 /**
  * ======================================================================
@@ -67,7 +107,8 @@
 SimilaritySearch::SimilaritySearch(databases_t &databases,
                                    std::string input, EntapDataPtrs& entap_data) {
     FS_dprint("Spawn object - SimilaritySearch");
-    std::string uninform_path;
+    std::string                        uninform_path;
+    std::vector<SymbolTable::symbol_t> input_ancestors;
 
     _pQUERY_DATA    = entap_data._pQueryData;
     _pUserInput     = entap_data._pUserInput;
@@ -83,16 +124,27 @@ SimilaritySearch::SimilaritySearch(databases_t &databases,
     _qcoverage        = _pUserInput->get_user_input<fp32>(UInput::INPUT_FLAG_QCOVERAGE);
     _tcoverage        = _pUserInput->get_user_input<fp32>(UInput::INPUT_FLAG_TCOVERAGE);
     _overwrite        = _pUserInput->has_input(UInput::INPUT_FLAG_OVERWRITE);
+    _stream_results   = _pUserInput->has_input(UInput::INPUT_FLAG_DMND_STREAM);
+    _retain_hits      = (uint32) _pUserInput->get_user_input<int>(UInput::INPUT_FLAG_RETAIN_HITS);
+    _memory_budget    = (uint64) _pUserInput->get_user_input<int>(UInput::INPUT_FLAG_SIM_MEMORY) << 20;
+    _diamond_jobs     = (uint32) std::max(1, _pUserInput->get_user_input<int>(UInput::INPUT_FLAG_DMND_JOBS));
+    _query_shards     = (uint32) std::max(1, _pUserInput->get_user_input<int>(UInput::INPUT_FLAG_DMND_SHARDS));
+    if (_pUserInput->has_input(UInput::INPUT_FLAG_DMND_CASCADE)) {
+        _cascade_mode = _pUserInput->get_user_input<std::string>(UInput::INPUT_FLAG_DMND_CASCADE);
+    }
     _e_val            = _pUserInput->get_user_input<fp64>(UInput::INPUT_FLAG_E_VAL);
     _threads          = _pUserInput->get_supported_threads();
-    _uninformative_vect= _pUserInput->get_uninformative_vect();
+    _uninformative_matcher.build(_pUserInput->get_uninformative_vect());
     _outpath          = _pFileSystem->get_root_path();
     _contaminants     = _pUserInput->get_contaminants();
     _software_flag    = ENTAP_EXECUTE::SIM_SEARCH_FLAG_DIAMOND; // Default DIAMOND software
+    _species_scanners = {&SimilaritySearch::scan_species_uniprot,
+                         &SimilaritySearch::scan_species_ncbi};     // Tried in order
 
     // Set sim search paths/directories
     _sim_search_dir  = PATHS(_outpath, SIM_SEARCH_DIR);
     _processed_path  = PATHS(_sim_search_dir, PROCESSED_DIR);
+    _shard_dir       = PATHS(_sim_search_dir, SHARD_DIR);
     _results_path    = PATHS(_sim_search_dir, RESULTS_DIR);
 
     if (_overwrite) {
@@ -106,6 +158,17 @@ SimilaritySearch::SimilaritySearch(databases_t &databases,
     _pFileSystem->create_dir(_results_path);
 
     _transcript_shortname = get_transcriptome_shortname();
+
+    // Get the taxonomic info (lineage) of the target species
+    _input_lineage = _pEntapDatabase->get_tax_entry(_input_species).lineage;
+
+    // Ancestor ID sets compared against each alignment lineage
+    split_lineage(_input_lineage, input_ancestors);
+    _input_ancestors.insert(input_ancestors.begin(), input_ancestors.end());
+    for (uint64 i = 0; i < _contaminants.size(); i++) {
+        if (_contaminants[i].empty()) continue;
+        _contaminant_ancestors.emplace(SYMBOL_TABLE.intern(_contaminants[i]), i);   // Keeps first
+    }
 }
 
 
@@ -178,10 +241,10 @@ void SimilaritySearch::parse_files(std::string new_input) {
     try {
         switch (_software_flag) {
             case ENTAP_EXECUTE::SIM_SEARCH_FLAG_DIAMOND:
-                diamond_parse(_contaminants);
+                diamond_parse();
                 break;
             default:
-                diamond_parse(_contaminants);
+                diamond_parse();
                 break;
         }
     } catch (ExceptionHandler &e) {throw e;}
@@ -196,6 +259,14 @@ void SimilaritySearch::parse_files(std::string new_input) {
  *                        pstreams library
  *                      - Returns vector of output files from sim search
  *                      - Checks whether DIAMOND has been ran previously
+ *                      - With more than one DIAMOND job, remaining searches
+ *                        are run concurrently (see run_diamond_searches)
+ *                      - With query shards, each shard is searched on its
+ *                        own and shards finished by an earlier run are
+ *                        skipped. Shard outputs are merged into the usual
+ *                        output file of each database
+ *                      - With a sensitivity cascade, each search runs as
+ *                        described in diamond_cascade
  *
  * Notes                - None
  *
@@ -207,9 +278,13 @@ std::vector<std::string> SimilaritySearch::diamond() {
     FS_dprint("Beginning to execute DIAMOND...");
 
     std::vector<std::string>    out_paths;
+    std::vector<uint32>         pending;        // Databases without output
+    std::vector<std::string>    shard_paths;    // Transcriptome shards
+    std::vector<std::vector<std::string>> shard_outputs;   // Per pending database
+    std::vector<DiamondSearch>  searches;
     std::string                 filename;
     std::string                 out_path;
-    std::string                 std_out;
+    std::string                 shard_out;
     std::string                 database_name;  // shortened name
 
     if (!_pFileSystem->file_exists(_input_path)) {
@@ -217,23 +292,67 @@ std::vector<std::string> SimilaritySearch::diamond() {
     }
 
     // database verification already ran, don't need to verify each path
+    // assume all paths should be .dmnd
+    for (std::string data_path : _database_paths) {
+        database_name = get_database_shortname(data_path);
+        filename = _blast_type + "_" + _transcript_shortname + "_" + database_name + FileSystem::EXT_OUT;
+        out_path = PATHS(_sim_search_dir,filename) ;
+        _file_to_database[out_path] = database_name;
+        out_paths.push_back(out_path);
+        if (_pFileSystem->file_exists(out_path)) {
+            FS_dprint("File found at " + out_path + " skipping execution against this database");
+            continue;
+        }
+        pending.push_back((uint32) out_paths.size() - 1);
+    }
+
     try {
-        // assume all paths should be .dmnd
-        for (std::string data_path : _database_paths) {
-            FS_dprint("Searching against database located at: " + data_path + "...");
-            database_name = get_database_shortname(data_path);
-            filename = _blast_type + "_" + _transcript_shortname + "_" + database_name + FileSystem::EXT_OUT;
-            out_path = PATHS(_sim_search_dir,filename) ;
-            std_out  = PATHS(_sim_search_dir,filename) + "_std";
-            _file_to_database[out_path] = database_name;
-            if (_pFileSystem->file_exists(out_path)) {
-                FS_dprint("File found at " + out_path + " skipping execution against this database");
-                out_paths.push_back(out_path);
+        if (_query_shards > 1 && !pending.empty()) shard_paths = split_query_shards();
+
+        for (uint32 index : pending) {
+            database_name = _file_to_database[out_paths[index]];
+            DiamondSearch search;
+            search.input    = _input_path;
+            search.database = _database_paths[index];
+            search.out_path = out_paths[index];
+            search.std_out  = out_paths[index] + "_std";
+            search.size     = _pFileSystem->get_file_size(_database_paths[index]);
+            search.threads  = _threads;
+            if (shard_paths.empty()) {
+                searches.push_back(search);
                 continue;
             }
-            diamond_blast(_input_path, out_path, std_out,data_path, _threads, _blast_type);
-            FS_dprint("Success! Results written to " + out_path);
-            out_paths.push_back(out_path);
+            shard_outputs.emplace_back();
+            for (uint32 i = 0; i < shard_paths.size(); i++) {
+                shard_out = PATHS(_shard_dir, _blast_type + "_" + _transcript_shortname + "_" + database_name +
+                                  get_shard_name(i, (uint32) shard_paths.size()) + FileSystem::EXT_OUT);
+                shard_outputs.back().push_back(shard_out);
+                if (_pFileSystem->file_exists(shard_out)) {
+                    FS_dprint("File found at " + shard_out + " skipping execution of this shard");
+                    continue;
+                }
+                search.input    = shard_paths[i];
+                search.out_path = shard_out;
+                search.std_out  = shard_out + "_std";
+                searches.push_back(search);
+            }
+        }
+
+        if (_diamond_jobs > 1 && searches.size() > 1) {
+            run_diamond_searches(searches);
+        } else {
+            for (DiamondSearch &search : searches) {
+                FS_dprint("Searching against database located at: " + search.database + "...");
+                run_diamond_search(search, shard_paths.empty());
+                FS_dprint("Success! Results written to " + search.out_path);
+            }
+        }
+
+        if (!shard_paths.empty()) {
+            for (uint32 i = 0; i < pending.size(); i++) {
+                merge_diamond_outputs(shard_outputs[i], out_paths[pending[i]]);
+            }
+            for (std::string &shard_path : shard_paths) _pFileSystem->delete_file(shard_path);
         }
     } catch (const ExceptionHandler &e) {throw e;}
     _sim_search_paths = out_paths;
@@ -241,6 +360,273 @@ std::vector<std::string> SimilaritySearch::diamond() {
 }
 
 
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::run_diamond_search(DiamondSearch &search, bool parse)
+ *
+ * Description          - Runs one DIAMOND search as selected by the user
+ *                        (cascade, streamed or to an output file)
+ *
+ * Notes                - Throws ExceptionHandler on failure
+ *
+ * @param search        - Search to run
+ * @param parse         - Parse streamed results while DIAMOND runs
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::run_diamond_search(DiamondSearch &search, bool parse) {
+    if (!_cascade_mode.empty()) {
+        diamond_cascade(search);
+    } else if (_stream_results) {
+        diamond_stream(search.input, search.out_path, search.std_out, search.database,
+                       search.threads, _blast_type, parse);
+    } else {
+        diamond_blast(search.input, search.out_path, search.std_out, search.database,
+                      search.threads, _blast_type);
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::run_diamond_searches(std::vector<DiamondSearch> &searches)
+ *
+ * Description          - Runs up to _diamond_jobs DIAMOND searches at once
+ *                      - Largest databases are started first. Each search
+ *                        is given a share of the free threads proportional
+ *                        to its size against the other searches that can
+ *                        start with it
+ *                      - Streamed results are saved but not parsed here,
+ *                        since parsing adds to shared query data
+ *
+ * Notes                - Throws ExceptionHandler of first failed search
+ *                        (database order) after running searches finish
+ *                      - Workers report back through their DiamondSearch,
+ *                        outcomes are logged here in database order
+ *
+ * @param searches      - Searches that have no output yet, database order
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::run_diamond_searches(std::vector<DiamondSearch> &searches) {
+    std::vector<DiamondSearch*> order;
+    std::vector<std::thread>    workers;
+    std::mutex                  lock;
+    std::condition_variable     finished;
+    uint32                      running = 0;
+    int                         free_threads = std::max(1, _threads);
+    uint64                      next = 0;
+    uint64                      group_size;
+    uint64                      slots;
+    bool                        failed = false;
+
+    for (DiamondSearch &search : searches) order.push_back(&search);
+    std::stable_sort(order.begin(), order.end(), [](const DiamondSearch *a, const DiamondSearch *b) {
+        return a->size > b->size;
+    });
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (next < order.size() && !failed) {
+        finished.wait(guard, [&] {return failed || (running < _diamond_jobs && free_threads > 0);});
+        if (failed) break;
+
+        // Size of searches that will share the free threads
+        slots = std::min((uint64) (_diamond_jobs - running), (uint64) (order.size() - next));
+        slots = std::min(slots, (uint64) free_threads);
+        group_size = 0;
+        for (uint64 i = next; i < next + slots; i++) group_size += std::max((uint64) 1, order[i]->size);
+
+        DiamondSearch *search = order[next++];
+        search->threads = group_size == 0 ? free_threads :
+                          (int) ((fp64) free_threads * std::max((uint64) 1, search->size) / group_size);
+        search->threads = std::max(1, std::min(search->threads, free_threads - (int) slots + 1));
+        free_threads -= search->threads;
+        running++;
+        FS_dprint("Searching against database located at: " + search->database + " with " +
+                  std::to_string(search->threads) + " threads...");
+
+        workers.push_back(std::thread([this, search, &lock, &finished, &running, &free_threads, &failed] {
+            diamond_search_job(search);
+            std::lock_guard<std::mutex> done(lock);
+            free_threads += search->threads;
+            running--;
+            if (!search->error.empty()) failed = true;
+            finished.notify_all();
+        }));
+    }
+    guard.unlock();
+    for (std::thread &worker : workers) worker.join();
+
+    for (DiamondSearch &search : searches) {
+        if (!search.error.empty()) {
+            throw ExceptionHandler(search.error, ERR_ENTAP_RUN_SIM_SEARCH_RUN);
+        }
+    }
+    // Every search ran once none failed
+    for (DiamondSearch &search : searches) {
+        FS_dprint("Success! Results written to " + search.out_path);
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_search_job(DiamondSearch *search)
+ *
+ * Description          - Worker job running one DIAMOND search
+ *
+ * Notes                - Failures are reported through the error field
+ *
+ * @param search        - Search to run
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_search_job(DiamondSearch *search) {
+    try {
+        run_diamond_search(*search, false);
+    } catch (ExceptionHandler &e) {
+        search->error = e.what();
+    } catch (const std::exception &e) {
+        search->error = e.what();
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function std::vector<std::string> SimilaritySearch::split_query_shards()
+ *
+ * Description          - Splits the input transcriptome into _query_shards
+ *                        files holding about the same number of residues
+ *                      - Sequences stay in input order, so merged shard
+ *                        output lists queries in the same order as a
+ *                        search of the whole transcriptome
+ *
+ * Notes                - Shards are rewritten on each run. Splitting the
+ *                        same input the same way gives the same shards,
+ *                        so finished shard outputs of earlier runs apply
+ *
+ * @return              - Paths to shard FASTA files, in shard order
+ * ======================================================================
+ */
+std::vector<std::string> SimilaritySearch::split_query_shards() {
+    std::vector<std::string> shard_paths;
+    std::vector<uint64>      lengths;       // Residues of each sequence
+    std::vector<uint64>      shard_starts;  // First sequence of each shard
+    std::string              line;
+    std::string              ext;
+    uint64                   total = 0;
+    uint64                   residues = 0;
+    uint64                   sequence = 0;
+    uint32                   shard_count;
+    uint32                   shard = 0;
+
+    std::ifstream in_file(_input_path);
+    while (std::getline(in_file, line)) {
+        if (line.empty()) continue;
+        if (line[0] == FASTA_FLAG[0]) {
+            lengths.push_back(0);
+        } else if (!lengths.empty()) {
+            lengths.back() += line.size();
+            total += line.size();
+        }
+    }
+    in_file.close();
+    if (lengths.empty()) {
+        throw ExceptionHandler("No sequences found in transcriptome: " + _input_path,
+                               ERR_ENTAP_RUN_SIM_SEARCH_RUN);
+    }
+
+    // Cut once a shard reaches its share, leaving a sequence for every later shard
+    shard_count = (uint32) std::min((uint64) _query_shards, (uint64) lengths.size());
+    shard_starts.push_back(0);
+    for (uint64 i = 0; i < lengths.size() && shard_starts.size() < shard_count; i++) {
+        residues += lengths[i];
+        if (residues * shard_count >= total * shard_starts.size() ||
+            lengths.size() - i - 1 <= shard_count - shard_starts.size()) {
+            shard_starts.push_back(i + 1);
+        }
+    }
+    shard_starts.push_back(lengths.size());
+    FS_dprint("Splitting " + std::to_string(lengths.size()) + " sequences (" + std::to_string(total) +
+              " residues) into " + std::to_string(shard_count) + " shards");
+
+    _pFileSystem->create_dir(_shard_dir);
+    ext = _blastp ? FileSystem::EXT_FAA : FileSystem::EXT_FNN;
+    for (uint32 i = 0; i < shard_count; i++) {
+        shard_paths.push_back(PATHS(_shard_dir, _transcript_shortname + get_shard_name(i, shard_count) + ext));
+    }
+
+    in_file.open(_input_path);
+    std::ofstream out_file(shard_paths[0], std::ios::out | std::ios::trunc);
+    while (std::getline(in_file, line)) {
+        if (line.empty()) continue;
+        if (line[0] == FASTA_FLAG[0]) {
+            if (sequence == shard_starts[shard + 1]) {
+                out_file.close();
+                out_file.open(shard_paths[++shard], std::ios::out | std::ios::trunc);
+            }
+            sequence++;
+        }
+        out_file << line << '\n';
+    }
+    out_file.close();
+    return shard_paths;
+}
+
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::merge_diamond_outputs(std::vector<std::string> &outputs,
+ *                                                        std::string &out_path)
+ *
+ * Description          - Concatenates DIAMOND output files, in order, into
+ *                        one output file (query shards or cascade passes)
+ *                      - Merged files are deleted afterwards
+ *
+ * Notes                - Merged through a .part file so the output file
+ *                        only appears complete
+ *
+ * @param outputs       - DIAMOND output files to merge
+ * @param out_path      - Merged DIAMOND output file
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::merge_diamond_outputs(std::vector<std::string> &outputs, std::string &out_path) {
+    std::string part_path;
+
+    FS_dprint("Merging " + std::to_string(outputs.size()) + " DIAMOND outputs into " + out_path);
+    part_path = out_path + FileSystem::EXT_PART;
+    std::ofstream out_file(part_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    for (std::string &output : outputs) {
+        std::ifstream in_file(output, std::ios::in | std::ios::binary);
+        if (!in_file.is_open()) {
+            out_file.close();
+            _pFileSystem->delete_file(part_path);
+            throw ExceptionHandler("Unable to open DIAMOND output: " + output,
+                                   ERR_ENTAP_RUN_SIM_SEARCH_RUN);
+        }
+        if (in_file.peek() != std::ifstream::traits_type::eof()) out_file << in_file.rdbuf();
+    }
+    out_file.close();
+    if (!out_file || !_pFileSystem->rename_file(part_path, out_path)) {
+        _pFileSystem->delete_file(part_path);
+        throw ExceptionHandler("Unable to merge DIAMOND outputs into: " + out_path,
+                               ERR_ENTAP_RUN_SIM_SEARCH_RUN);
+    }
+    for (std::string &output : outputs) _pFileSystem->delete_file(output);
+}
+
+
+std::string SimilaritySearch::get_shard_name(uint32 shard, uint32 shard_count) {
+    return SHARD_TAG + std::to_string(shard + 1) + "_of_" + std::to_string(shard_count);
+}
+
+
 /**
  * ======================================================================
  * Function void SimilaritySearch::diamond_blast(std::string input_file, std::string output_file, std::string std_out,
@@ -257,36 +643,245 @@ std::vector<std::string> SimilaritySearch::diamond() {
  * @param database      - Selected database to hit against
  * @param threads       - Thread number
  * @param blast         - Blast type (blastx/blastp)
+ * @param sensitivity   - DIAMOND sensitivity mode
  *
  * @return              - None
  * ======================================================================
  */
 void SimilaritySearch::diamond_blast(std::string input_file, std::string output_file, std::string std_out,
-                   std::string &database,int &threads, std::string &blast) {
+                   std::string &database,int &threads, std::string &blast, const std::string &sensitivity) {
 
     std::string        diamond_run;
+    std::string        part_path;
 
-    diamond_run =
-            _diamond_exe + " "
-            + blast +
-            " -d " + database    +
-            " --query-cover "    + std::to_string(_qcoverage) +
-            " --subject-cover "  + std::to_string(_tcoverage) +
-            " --evalue "         + std::to_string(_e_val) +
-            " --more-sensitive"  +
-            " --top 3"           +
-            " -q " + input_file  +
-            " -o " + output_file +
-            " -p " + std::to_string(threads) +
-            " -f " + "6 qseqid sseqid pident length mismatch gapopen "
-                     "qstart qend sstart send evalue bitscore qcovhsp stitle";
-
-    if (TC_execute_cmd(diamond_run, std_out) != 0) {
+    // Written to a .part file so an interrupted run never leaves an output file
+    part_path   = output_file + FileSystem::EXT_PART;
+    diamond_run = diamond_cmd(input_file, database, threads, blast, sensitivity) + " -o " + part_path;
+
+    if (TC_execute_cmd(diamond_run, std_out) != 0 || !_pFileSystem->rename_file(part_path, output_file)) {
         // Delete output file if run failed
-        _pFileSystem->delete_file(output_file);
+        _pFileSystem->delete_file(part_path);
+        throw ExceptionHandler("Error in DIAMOND run with database located at: " +
+                               database, ERR_ENTAP_RUN_SIM_SEARCH_RUN);
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_cascade(DiamondSearch &search)
+ *
+ * Description          - Runs a DIAMOND search as a sensitivity cascade
+ *                      - All queries are first searched in fast mode. Only
+ *                        queries without a hit against this database are
+ *                        searched again at the cascade sensitivity
+ *                      - Output of both passes is merged into the search
+ *                        output file
+ *
+ * Notes                - Passes that finished in an earlier run are kept
+ *                        and skipped
+ *
+ * @param search        - Search to run
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_cascade(DiamondSearch &search) {
+    std::vector<std::string> outputs;
+    std::string              base_path;
+    std::string              fast_out;
+    std::string              cascade_out;
+    std::string              no_hits_path;
+    uint64                   no_hits;
+
+    base_path = search.out_path;
+    if (base_path.size() >= FileSystem::EXT_OUT.size() &&
+        base_path.compare(base_path.size() - FileSystem::EXT_OUT.size(),
+                          FileSystem::EXT_OUT.size(), FileSystem::EXT_OUT) == 0) {
+        base_path.erase(base_path.size() - FileSystem::EXT_OUT.size());
+    }
+    fast_out     = base_path + "_" + DMND_FAST + FileSystem::EXT_OUT;
+    cascade_out  = base_path + "_" + _cascade_mode + FileSystem::EXT_OUT;
+    no_hits_path = base_path + CASCADE_NO_HITS_TAG + (_blastp ? FileSystem::EXT_FAA : FileSystem::EXT_FNN);
+
+    if (_pFileSystem->file_exists(fast_out)) {
+        FS_dprint("File found at " + fast_out + " skipping fast pass");
+    } else {
+        diamond_blast(search.input, fast_out, search.std_out + "_" + DMND_FAST, search.database,
+                      search.threads, _blast_type, DMND_FAST);
+    }
+    outputs.push_back(fast_out);
+
+    if (_pFileSystem->file_exists(cascade_out)) {
+        FS_dprint("File found at " + cascade_out + " skipping " + _cascade_mode + " pass");
+        outputs.push_back(cascade_out);
+    } else {
+        no_hits = write_cascade_queries(search.input, fast_out, no_hits_path);
+        FS_dprint(std::to_string(no_hits) + " queries without a fast mode hit against " + search.database);
+        if (no_hits > 0) {
+            diamond_blast(no_hits_path, cascade_out, search.std_out + "_" + _cascade_mode, search.database,
+                          search.threads, _blast_type, _cascade_mode);
+            outputs.push_back(cascade_out);
+        }
+        _pFileSystem->delete_file(no_hits_path);
+    }
+    merge_diamond_outputs(outputs, search.out_path);
+}
+
+
+/**
+ * ======================================================================
+ * Function uint64 SimilaritySearch::write_cascade_queries(std::string &input_path,
+ *                                       std::string &dmnd_out, std::string &out_path)
+ *
+ * Description          - Writes the sequences of a FASTA file that have no
+ *                        alignment in a DIAMOND output file
+ *
+ * Notes                - Sequence IDs are matched as DIAMOND reports them
+ *                        (header up to the first whitespace)
+ *
+ * @param input_path    - FASTA searched by DIAMOND
+ * @param dmnd_out      - DIAMOND output of that search
+ * @param out_path      - FASTA of sequences without hits
+ *
+ * @return              - Number of sequences written
+ * ======================================================================
+ */
+uint64 SimilaritySearch::write_cascade_queries(std::string &input_path, std::string &dmnd_out,
+                                               std::string &out_path) {
+    std::unordered_set<std::string> hit_queries;
+    std::string                     line;
+    uint64                          count = 0;
+    bool                            write = false;
+
+    std::ifstream dmnd_file(dmnd_out);
+    while (std::getline(dmnd_file, line)) {
+        if (!line.empty()) hit_queries.insert(line.substr(0, line.find('\t')));
+    }
+    dmnd_file.close();
+
+    std::ifstream in_file(input_path);
+    std::ofstream out_file(out_path, std::ios::out | std::ios::trunc);
+    while (std::getline(in_file, line)) {
+        if (line.empty()) continue;
+        if (line[0] == FASTA_FLAG[0]) {
+            write = hit_queries.find(line.substr(1, line.find_first_of(" \t\r") - 1)) == hit_queries.end();
+            if (write) count++;
+        }
+        if (write) out_file << line << '\n';
+    }
+    out_file.close();
+    if (!out_file) {
+        throw ExceptionHandler("Unable to write queries without hits to: " + out_path,
+                               ERR_ENTAP_RUN_SIM_SEARCH_RUN);
+    }
+    return count;
+}
+
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_stream(std::string input_file, std::string output_file,
+ *                   std::string std_out, std::string &database,int &threads, std::string &blast,
+ *                   bool parse)
+ *
+ * Description          - Executes DIAMOND with results sent to stdout and
+ *                        parses alignments as they are produced
+ *                      - Results are copied to a .part file which is renamed
+ *                        to the output file once DIAMOND finishes, so later
+ *                        runs can skip this database
+ *
+ * Notes                - Std err is written to std_out.err
+ *
+ * @param input_file    - Path to input transcriptome
+ * @param output_file   - Path to output file from sim search
+ * @param std_out       - Std out/err path
+ * @param database      - Selected database to hit against
+ * @param threads       - Thread number
+ * @param blast         - Blast type (blastx/blastp)
+ * @param parse         - Parse alignments while streaming, otherwise they
+ *                        are only saved and parsed from the output file
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_stream(std::string input_file, std::string output_file, std::string std_out,
+                                      std::string &database, int &threads, std::string &blast, bool parse) {
+
+    std::string        diamond_run;
+    std::string        part_path;
+    int                status;
+
+    part_path   = output_file + FileSystem::EXT_PART;
+    diamond_run = diamond_cmd(input_file, database, threads, blast) + " 2> " + std_out + FileSystem::EXT_ERR;
+    FS_dprint("Executing command: \n" + diamond_run +
+              "\nStreaming results through: " + part_path);
+
+    redi::ipstream child(diamond_run, redi::pstreams::pstdout);
+    std::ofstream  part_file(part_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    TeeStreambuf   tee_buf(child.out().rdbuf(), part_file);
+    std::istream   tee_stream(&tee_buf);
+
+    parse = parse && _memory_budget == 0;   // Out of core parsing reads the finished file into runs
+    try {
+        if (!parse) {
+            tee_stream.ignore(std::numeric_limits<std::streamsize>::max());
+        } else {
+            io::CSVReader<DMND_COL_NUMBER, io::trim_chars<' '>, io::no_quote_escape<'\t'>> in(output_file, tee_stream);
+            diamond_parse_rows(in, output_file);
+        }
+    } catch (...) {
+        child.close();
+        part_file.close();
+        _pFileSystem->delete_file(part_path);
+        throw;
+    }
+    child.close();
+    part_file.close();
+    status = child.rdbuf()->exited() ? child.rdbuf()->status() : 1;
+
+    if (status != 0 || !_pFileSystem->rename_file(part_path, output_file)) {
+        _pFileSystem->delete_file(part_path);
         throw ExceptionHandler("Error in DIAMOND run with database located at: " +
                                database, ERR_ENTAP_RUN_SIM_SEARCH_RUN);
     }
+    if (parse) _streamed_paths.insert(output_file);
+}
+
+/**
+ * ======================================================================
+ * Function std::string SimilaritySearch::diamond_cmd(std::string &input_file, std::string &database,
+ *                                                    int &threads, std::string &blast,
+ *                                                    const std::string &sensitivity)
+ *
+ * Description          - Generates DIAMOND command, without an output file
+ *                        (results go to stdout)
+ *
+ * Notes                - None
+ *
+ * @param input_file    - Path to input transcriptome
+ * @param database      - Selected database to hit against
+ * @param threads       - Thread number
+ * @param blast         - Blast type (blastx/blastp)
+ * @param sensitivity   - DIAMOND sensitivity mode (fast is DIAMOND default)
+ *
+ * @return              - DIAMOND command
+ * ======================================================================
+ */
+std::string SimilaritySearch::diamond_cmd(std::string &input_file, std::string &database, int &threads,
+                                          std::string &blast, const std::string &sensitivity) {
+    return _diamond_exe + " "
+           + blast +
+           " -d " + database    +
+           " --query-cover "    + std::to_string(_qcoverage) +
+           " --subject-cover "  + std::to_string(_tcoverage) +
+           " --evalue "         + std::to_string(_e_val) +
+           (sensitivity == DMND_FAST ? "" : " --" + sensitivity) +
+           " --top 3"           +
+           " -q " + input_file  +
+           " -p " + std::to_string(threads) +
+           " -f " + "6 qseqid sseqid pident length mismatch gapopen "
+                    "qstart qend sstart send evalue bitscore qcovhsp stitle";
 }
 
 
@@ -331,110 +926,614 @@ std::vector<std::string> SimilaritySearch::verify_diamond_files() {
     return out_list;
 }
 
-// input: 3 database string array of selected databases
-void SimilaritySearch::diamond_parse(std::vector<std::string>& contams) {
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_parse()
+ *
+ * Description          - Parses DIAMOND output of each selected database
+ *                        and selects best hits
+ *                      - Each database file is parsed on its own worker
+ *                        while alignments are added to queries in database
+ *                        order, so best hits do not depend on scheduling
+ *                      - Per database statistics and output are also
+ *                        generated concurrently, and logged in order
+ *                      - With a memory budget, alignments are parsed out
+ *                        of core (see diamond_parse_runs)
+ *                      - Overall best hits are then selected from database
+ *                        best hits in database order, however the files
+ *                        were parsed (streamed, resumed or out of core)
+ *
+ * Notes                - Throws ExceptionHandler on failure
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_parse() {
     FS_dprint("Beginning to filter individual diamond_files...");
+    std::vector<DiamondParseJob> jobs(_sim_search_paths.size());
+
+    for (uint32 i = 0; i < _sim_search_paths.size(); i++) {
+        // Confirm we have legit path / not empty
+        if (!_pFileSystem->file_exists(_sim_search_paths[i]) || _pFileSystem->file_empty(_sim_search_paths[i])) {
+            // Should never fall into here
+            throw ExceptionHandler("File not found or empty: " + _sim_search_paths[i], ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+        }
+        jobs[i].path  = _sim_search_paths[i];
+        jobs[i].index = i;
+    }
+
+    if (_memory_budget > 0) {
+        diamond_parse_runs(jobs);
+    } else {
+        merge_staged_batches(jobs);
+    }
+
+    // Files parsed while streaming are merged before the rest, so the overall
+    // best hit is chosen again in database order to match a fresh run
+    for (QuerySequence *query : *_pQUERY_DATA->get_sequences_ptr()) {
+        query->select_best_hit<SimSearchAlignment>(SIMILARITY_SEARCH, _sim_search_paths);
+    }
+
+    FS_dprint("Files parsed, calculating statistics and writing output...");
+    run_diamond_jobs(&SimilaritySearch::diamond_stats_job, jobs);
+    for (DiamondParseJob &job : jobs) {
+        if (!job.error.empty()) throw ExceptionHandler(job.error, ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+        _pFileSystem->print_stats(job.stats);
+    }
+    FS_dprint("Success!");
+
+    FS_dprint("Calculating overall Similarity Searching statistics...");
+    std::string out_msg = calculate_best_stats(true);
+    _pFileSystem->print_stats(out_msg);
+    FS_dprint("Success!");
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::run_diamond_jobs(diamond_job_t job,
+ *                                          std::vector<DiamondParseJob> &jobs)
+ *
+ * Description          - Runs a job over every DIAMOND file, one file per
+ *                        worker at a time (up to user thread count)
+ *
+ * Notes                - Jobs report failures through their error field
+ *
+ * @param job           - Job to run on each file
+ * @param jobs          - One entry per DIAMOND file
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::run_diamond_jobs(diamond_job_t job, std::vector<DiamondParseJob> &jobs) {
+    std::vector<std::thread> workers;
+    std::atomic<uint32>      next(0);
+    uint32                   thread_count;
+
+    thread_count = (uint32) std::min((uint64) std::max(1, _threads), (uint64) jobs.size());
+    for (uint32 i = 1; i < thread_count; i++) {
+        workers.push_back(std::thread(&SimilaritySearch::diamond_job_worker, this, job, &jobs, &next));
+    }
+    diamond_job_worker(job, &jobs, &next);
+    for (std::thread &worker : workers) worker.join();
+}
+
+void SimilaritySearch::diamond_job_worker(diamond_job_t job, std::vector<DiamondParseJob> *jobs,
+                                          std::atomic<uint32> *next) {
+    uint32 index;
+
+    while ((index = (*next)++) < jobs->size()) {
+        (this->*job)(&(*jobs)[index]);
+    }
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_parse_job(DiamondParseJob *job)
+ *
+ * Description          - Worker job reading one DIAMOND file into staged
+ *                        alignments (or alignment runs)
+ *
+ * Notes                - Files already parsed while DIAMOND was streaming
+ *                        are skipped
+ *
+ * @param job           - DIAMOND file to parse
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_parse_job(DiamondParseJob *job) {
+    if (_streamed_paths.find(job->path) != _streamed_paths.end()) {
+        FS_dprint("Diamond file located at " + job->path + " already parsed during execution");
+    } else {
+        FS_dprint("Diamond file located at " + job->path + " being filtered");
+        try {
+            // Begin using CSVReader lib to parse data
+            io::CSVReader<DMND_COL_NUMBER, io::trim_chars<' '>, io::no_quote_escape<'\t'>> in(job->path);
+            diamond_stage_rows(in, *job);
+            if (job->runs) job->runs->flush();
+        } catch (ExceptionHandler &e) {
+            job->error = e.what();
+        } catch (const std::exception &e) {
+            job->error = e.what();
+        }
+    }
+    std::lock_guard<std::mutex> guard(job->lock);
+    job->done = true;
+    job->batch_cond.notify_all();
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_stats_job(DiamondParseJob *job)
+ *
+ * Description          - Worker job writing best hit output and statistics
+ *                        for one database
+ *
+ * Notes                - Statistics are kept in the job to be logged in
+ *                        database order
+ *
+ * @param job           - DIAMOND file to summarize
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_stats_job(DiamondParseJob *job) {
+    try {
+        job->stats = calculate_best_stats(false, job->path);
+    } catch (ExceptionHandler &e) {
+        job->error = e.what();
+    } catch (const std::exception &e) {
+        job->error = e.what();
+    }
+}
 
-    tax_serial_map_t                                taxonomic_database;
-    std::list<std::map<std::string,QuerySequence>>  database_maps;
-    std::pair<bool,std::string>                     contam_info;
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_parse_rows(Reader &in, std::string &data)
+ *
+ * Description          - Reads DIAMOND tabular rows and adds each as an
+ *                        alignment to its query sequence
+ *                      - Used by streamed DIAMOND runs
+ *
+ * Notes                - Throws ExceptionHandler if a query is not found
+ *
+ * @param in            - CSVReader over DIAMOND output (file or stream)
+ * @param data          - Path to DIAMOND output file
+ *
+ * @return              - None
+ * ======================================================================
+ */
+template<class Reader>
+void SimilaritySearch::diamond_parse_rows(Reader &in, std::string &data) {
+    DiamondParseJob job;
+
+    job.path         = data;
+    job.merge_inline = true;    // Rows are added as DIAMOND produces them
+    diamond_stage_rows(in, job);
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_stage_rows(Reader &in, DiamondParseJob &job)
+ *
+ * Description          - Reads DIAMOND tabular rows into alignment results
+ *                        with species and informativeness set
+ *
+ * Notes                - Only touches the job, safe to run for several
+ *                        files at once
+ *                      - Rows are handed off in bounded batches (see
+ *                        flush_staged_rows), so staging memory does not
+ *                        grow with the file
+ *                      - Rows go to the job's alignment runs instead when
+ *                        parsing out of core
+ *
+ * @param in            - CSVReader over DIAMOND output (file or stream)
+ * @param job           - Job of DIAMOND output file, rows staged here
+ *
+ * @return              - None
+ * ======================================================================
+ */
+template<class Reader>
+void SimilaritySearch::diamond_stage_rows(Reader &in, DiamondParseJob &job) {
     std::string                                     species;
-    TaxEntry                                        taxEntry;
     SimSearchResults                                simSearchResults;
+    SymbolTable::symbol_t                           database_symbol;
+    AlignmentRuns::Record                           record;
+    uint64                                          row = 0;
 
     // ------------------ Read from DIAMOND output ---------------------- //
     std::string qseqid;
-    std::string sseqid, stitle, database_name,pident, bitscore,
-            length, mismatch, gapopen, qstart, qend, sstart, send;
-    fp64 evalue;
-    fp64 coverage;
+    std::string sseqid, stitle;
+    char  *pident = nullptr;
+    uint32 length, mismatch, gapopen, qstart, qend, sstart, send;
+    fp32   bitscore;
+    fp64   evalue;
+    fp64   coverage;
     // ----------------------------------------------------------------- //
 
-    // Get the taxonomic info (lineage) of the target species
-    taxEntry = _pEntapDatabase->get_tax_entry(_input_species);
-    _input_lineage = taxEntry.lineage;
+    database_symbol = SYMBOL_TABLE.intern(job.path);
+
+    // Stage rows so taxonomic information can be resolved by batch
+    while (in.read_row(qseqid, sseqid, pident, length, mismatch, gapopen,
+                       qstart, qend, sstart, send, evalue, bitscore, coverage,stitle)) {
+        simSearchResults = {};
+
+        // Compile sim search data
+        simSearchResults.database_path = database_symbol;
+        simSearchResults.qseqid = qseqid;
+        simSearchResults.sseqid = sseqid;
+        set_percent_identity(pident, simSearchResults);
+        simSearchResults.length = length;
+        simSearchResults.mismatch = mismatch;
+        simSearchResults.gapopen = gapopen;
+        simSearchResults.qstart = qstart;
+        simSearchResults.qend = qend;
+        simSearchResults.sstart = sstart;
+        simSearchResults.send = send;
+        simSearchResults.stitle = stitle;
+        simSearchResults.bit_score = bitscore;
+        simSearchResults.e_val_raw = evalue;
+        simSearchResults.coverage_raw = coverage;
+        simSearchResults.is_informative = is_informative(job, sseqid, stitle);
+
+        // get species from database alignment title
+        species = get_species(job, sseqid, stitle);
+        job.staged.species.insert(species);
+        if (job.runs) {
+            record.query_id = _pQUERY_DATA->get_sequences_ptr()->find_id(qseqid);
+            if (record.query_id == QueryStore::QUERY_ID_NONE) {
+                throw ExceptionHandler("Unable to find sequence in transcriptome: " + qseqid + " from file: " + job.path,
+                                       ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+            }
+            record.database = job.index;
+            record.row      = row++;
+            record.results  = std::move(simSearchResults);
+            record.species  = species;
+            job.runs->add(record);
+        } else {
+            job.staged.rows.emplace_back(simSearchResults, species);
+            if (job.staged.rows.size() >= STAGE_BATCH_ROWS ||
+                job.staged.species.size() >= STAGE_BATCH_SPECIES) {
+                flush_staged_rows(job);
+            }
+        }
+    }
+    if (!job.runs) flush_staged_rows(job);
+}
 
-    for (std::string &data : _sim_search_paths) {
-        FS_dprint("Diamond file located at " + data + " being filtered");
-        std::stringstream out_stream;
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::flush_staged_rows(DiamondParseJob &job)
+ *
+ * Description          - Passes on the batch of rows staged by a reader
+ *                      - Streamed runs merge the batch right away, other
+ *                        readers queue it for merge_staged_batches and
+ *                        wait while STAGE_QUEUE_BATCHES are queued
+ *
+ * Notes                - Throws ExceptionHandler if merging was aborted
+ *
+ * @param job           - Job with staged rows
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::flush_staged_rows(DiamondParseJob &job) {
+    if (job.staged.rows.empty()) return;
+    if (job.merge_inline) {
+        diamond_merge_rows(job, job.staged);
+        return;
+    }
+    std::unique_lock<std::mutex> guard(job.lock);
+    job.batch_cond.wait(guard, [&job] {return job.abort || job.batches.size() < STAGE_QUEUE_BATCHES;});
+    if (job.abort) throw ExceptionHandler("Parsing aborted", ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+    job.batches.push_back(std::move(job.staged));
+    job.staged = StagedRows();
+    job.batch_cond.notify_all();
+}
 
-        // Confirm we have legit path / not empty
-        if (!_pFileSystem->file_exists(data) || _pFileSystem->file_empty(data)) {
-            // Should never fall into here
-            throw ExceptionHandler("File not found or empty: " + data, ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::merge_staged_batches(std::vector<DiamondParseJob> &jobs)
+ *
+ * Description          - Parses every DIAMOND file on workers while adding
+ *                        their batches to queries on this thread, one
+ *                        database after another
+ *
+ * Notes                - Throws ExceptionHandler on failure, after
+ *                        stopping the workers
+ *
+ * @param jobs          - One entry per DIAMOND file
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::merge_staged_batches(std::vector<DiamondParseJob> &jobs) {
+    StagedRows  batch;
+    std::thread readers(&SimilaritySearch::run_diamond_jobs, this, &SimilaritySearch::diamond_parse_job,
+                        std::ref(jobs));
+
+    try {
+        for (DiamondParseJob &job : jobs) {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> guard(job.lock);
+                    job.batch_cond.wait(guard, [&job] {return job.done || !job.batches.empty();});
+                    if (job.batches.empty()) break;     // Done, everything merged
+                    batch = std::move(job.batches.front());
+                    job.batches.pop_front();
+                    job.batch_cond.notify_all();
+                }
+                diamond_merge_rows(job, batch);
+            }
+            if (!job.error.empty()) {
+                throw ExceptionHandler("Unable to parse DIAMOND file: " + job.path + "\n" + job.error,
+                                       ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+            }
         }
+    } catch (...) {
+        for (DiamondParseJob &job : jobs) {
+            std::lock_guard<std::mutex> guard(job.lock);
+            job.abort = true;
+            job.batch_cond.notify_all();
+        }
+        readers.join();
+        throw;
+    }
+    readers.join();
+}
 
-        // Set up individual database directories for stats
-        database_name = _file_to_database[data];
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_merge_rows(DiamondParseJob &job, StagedRows &batch)
+ *
+ * Description          - Resolves species of a batch of staged rows against
+ *                        the taxonomic database at once and adds each row
+ *                        as an alignment to its query sequence
+ *
+ * Notes                - Throws ExceptionHandler if a query is not found
+ *                      - Not thread safe, run in database order
+ *
+ * @param job           - Job the rows were read by
+ * @param batch         - Staged rows, released after
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_merge_rows(DiamondParseJob &job, StagedRows &batch) {
+    if (batch.rows.empty()) return;
+    _pEntapDatabase->resolve_batch(vect_str_t(batch.species.begin(), batch.species.end()));
 
-        // Begin using CSVReader lib to parse data
-        io::CSVReader<DMND_COL_NUMBER, io::trim_chars<' '>, io::no_quote_escape<'\t'>> in(data);
-        while (in.read_row(qseqid, sseqid, pident, length, mismatch, gapopen,
-                           qstart, qend, sstart, send, evalue, bitscore, coverage,stitle)) {
-            simSearchResults = {};
+    for (std::pair<SimSearchResults, std::string> &row : batch.rows) {
+        SimSearchResults &results = row.first;
 
-            // get species from database alignment (using regex)
-            species = get_species(stitle);
-            // get taxonomic information with species
-            taxEntry = _pEntapDatabase->get_tax_entry(species);
-            // get contaminant information
-            contam_info = is_contaminant(taxEntry.lineage, taxonomic_database,contams);
+        set_taxonomy(results, row.second);
 
-            // Get pointer to sequence in overall map
-            QuerySequence *query = _pQUERY_DATA->get_sequence(qseqid);
+        // Get pointer to sequence in overall map
+        QuerySequence *query = _pQUERY_DATA->get_sequence(results.qseqid);
 
-            if (query == nullptr) {
-                throw ExceptionHandler("Unable to find sequence in transcriptome: " + qseqid + " from file: " + data,
-                                       ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
-            }
+        if (query == nullptr) {
+            throw ExceptionHandler("Unable to find sequence in transcriptome: " + results.qseqid + " from file: " + job.path,
+                                   ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+        }
 
-            // Compile sim search data
-            simSearchResults.database_path = data;
-            simSearchResults.qseqid = qseqid;
-            simSearchResults.sseqid = sseqid;
-            simSearchResults.pident = pident;
-            simSearchResults.length = length;
-            simSearchResults.mismatch = mismatch;
-            simSearchResults.gapopen = gapopen;
-            simSearchResults.qstart = qstart;
-            simSearchResults.qend = qend;
-            simSearchResults.sstart = sstart;
-            simSearchResults.send = send;
-            simSearchResults.stitle = stitle;
-            simSearchResults.bit_score = bitscore;
-            simSearchResults.lineage = taxEntry.lineage;
-            simSearchResults.species = species;
-            simSearchResults.e_val_raw = evalue;
-            simSearchResults.e_val = float_to_sci(evalue,2);
-            simSearchResults.coverage_raw = coverage;
-            simSearchResults.coverage = float_to_string(coverage);
-            simSearchResults.contaminant = contam_info.first;
-            simSearchResults.contam_type = contam_info.second;
-            simSearchResults.contaminant ? simSearchResults.yes_no_contam = "Yes" :
-                    simSearchResults.yes_no_contam  = "No";
-            simSearchResults.is_informative = is_informative(stitle);
-            simSearchResults.is_informative ? simSearchResults.yes_no_inform = "Yes" :
-                    simSearchResults.yes_no_inform  = "No";
-
-            query->add_alignment<SimSearchAlignment, SimSearchResults>(
-                    SIMILARITY_SEARCH,
-                    _software_flag,
-                    simSearchResults,
-                    data,
-                    _input_lineage);
-        }
-
-        FS_dprint("File parsed, calculating statistics and writing output...");
-        calculate_best_stats(false,data);
-
-        FS_dprint("Success!");
+        query->add_alignment<SimSearchAlignment, SimSearchResults>(
+                SIMILARITY_SEARCH,
+                _software_flag,
+                results,
+                job.path,
+                *_pQUERY_DATA->get_alignment_pool(),
+                _retain_hits);
+    }
+    batch = StagedRows();
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::set_taxonomy(SimSearchResults &results,
+ *                                              std::string &species)
+ *
+ * Description          - Sets species, lineage, contaminant status and
+ *                        taxonomic score of an alignment
+ *
+ * Notes                - Species should already be resolved by batch
+ *                      - Species and lineage handles are cached per species,
+ *                        so rows do not intern full lineage strings
+ *
+ * @param results       - Alignment results to update
+ * @param species       - Species parsed from alignment title
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::set_taxonomy(SimSearchResults &results, std::string &species) {
+    auto cached = _taxonomy_cache.find(species);
+
+    if (cached == _taxonomy_cache.end()) {
+        // get taxonomic information with species (cached by batch)
+        TaxEntry taxEntry = _pEntapDatabase->get_tax_entry(species);
+        cached = _taxonomy_cache.emplace(species, std::make_pair(SYMBOL_TABLE.intern(species),
+                                                                 SYMBOL_TABLE.intern(taxEntry.lineage))).first;
+    }
+    results.species = cached->second.first;
+    results.lineage = cached->second.second;
+    // get contaminant information and ancestors shared with target species
+    const LineageInfo &lineage_info = get_lineage_info(results.lineage);
+
+    results.contaminant = lineage_info.contaminant;
+    results.contam_type = lineage_info.contam_type;
+    results.tax_score = lineage_info.shared_ancestors;
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_parse_runs(std::vector<DiamondParseJob> &jobs)
+ *
+ * Description          - Out of core parsing for very large searches
+ *                      - Each DIAMOND file is parsed on its own worker into
+ *                        sorted binary runs, within the user memory budget
+ *                      - Runs of all databases are then merged one query at
+ *                        a time to select best hits
+ *
+ * Notes                - Throws ExceptionHandler on failure
+ *
+ * @param jobs          - One entry per DIAMOND file
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_parse_runs(std::vector<DiamondParseJob> &jobs) {
+    std::string run_prefix;
+    uint64      worker_budget;
+
+    worker_budget = _memory_budget / std::min((uint64) std::max(1, _threads), (uint64) jobs.size());
+    worker_budget = std::max(worker_budget, RUN_BUDGET_MIN);
+    FS_dprint("Parsing DIAMOND files out of core, " + std::to_string(worker_budget) + " bytes per worker");
+
+    for (DiamondParseJob &job : jobs) {
+        run_prefix = PATHS(_pFileSystem->get_temp_outdir(), SIM_SEARCH_RUN_PREFIX + std::to_string(job.index));
+        job.runs.reset(new AlignmentRuns(run_prefix, worker_budget));
+    }
+
+    run_diamond_jobs(&SimilaritySearch::diamond_parse_job, jobs);
+    for (DiamondParseJob &job : jobs) {
+        if (!job.error.empty()) {
+            throw ExceptionHandler("Unable to parse DIAMOND file: " + job.path + "\n" + job.error,
+                                   ERR_ENTAP_RUN_SIM_SEARCH_FILTER);
+        }
+        FS_dprint(std::to_string(job.runs->size()) + " alignments from " + job.path + " in " +
+                  std::to_string(job.runs->get_run_paths().size()) + " runs");
+        _pEntapDatabase->resolve_batch(vect_str_t(job.staged.species.begin(), job.staged.species.end()));
+        job.staged.species.clear();
+    }
+
+    diamond_merge_runs(jobs);
+    for (DiamondParseJob &job : jobs) {
+        job.runs.reset();   // Deletes run files
     }
-    FS_dprint("Calculating overall Similarity Searching statistics...");
-    calculate_best_stats(true);
-    FS_dprint("Success!");
 }
 
-void SimilaritySearch::calculate_best_stats (bool is_final, std::string database_path) {
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::diamond_merge_runs(std::vector<DiamondParseJob> &jobs)
+ *
+ * Description          - Streams alignment runs of every database back in
+ *                        query order and adds them to their query
+ *                      - Once a query is complete its unselected hits are
+ *                        written and released, so only best hits stay in
+ *                        memory
+ *
+ * Notes                - Alignments of a query are added in database then
+ *                        file order, same as in memory parsing, so best hit
+ *                        selection is unchanged
+ *
+ * @param jobs          - One entry per DIAMOND file, with alignment runs
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::diamond_merge_runs(std::vector<DiamondParseJob> &jobs) {
+    std::vector<std::string>                    run_paths;
+    std::vector<SymbolTable::symbol_t>          database_symbols;
+    std::vector<std::unique_ptr<std::ofstream>> unselected_files;
+    std::string                                 base_path;
+    AlignmentRunMerger                          merger(PATHS(_pFileSystem->get_temp_outdir(), SIM_SEARCH_RUN_PREFIX + "merge"),
+                                                       _memory_budget);
+    AlignmentRuns::Record                       record;
+    QuerySequence                              *query = nullptr;
+
+    for (DiamondParseJob &job : jobs) {
+        const std::vector<std::string> &paths = job.runs->get_run_paths();
+        run_paths.insert(run_paths.end(), paths.begin(), paths.end());
+        database_symbols.push_back(SYMBOL_TABLE.intern(job.path));
+
+        // Unselected hits are written here rather than with best hit statistics
+        base_path = get_processed_dir(job.path);
+        _pFileSystem->create_dir(base_path);
+        unselected_files.emplace_back(new std::ofstream(PATHS(base_path, SIM_SEARCH_DATABASE_UNSELECTED),
+                                                        std::ios::out | std::ios::app));
+        print_header(*unselected_files.back());
+    }
+
+    merger.open(run_paths);
+    while (merger.next(record)) {
+        if (query == nullptr || query->get_query_id() != record.query_id) {
+            if (query != nullptr) write_unselected_hits(query, jobs, unselected_files);
+            query = _pQUERY_DATA->get_sequences_ptr()->at(record.query_id);
+        }
+        DiamondParseJob  &job     = jobs[record.database];
+        SimSearchResults &results = record.results;
+
+        results.qseqid        = query->get_seq_id();
+        results.database_path = database_symbols[record.database];
+        set_taxonomy(results, record.species);
+
+        query->add_alignment<SimSearchAlignment, SimSearchResults>(
+                SIMILARITY_SEARCH,
+                _software_flag,
+                results,
+                job.path,
+                *_pQUERY_DATA->get_alignment_pool());
+    }
+    if (query != nullptr) write_unselected_hits(query, jobs, unselected_files);
+
+    for (std::unique_ptr<std::ofstream> &file : unselected_files) {
+        _pFileSystem->close_file(*file);
+    }
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::write_unselected_hits(QuerySequence *query,
+ *                          std::vector<DiamondParseJob> &jobs,
+ *                          std::vector<std::unique_ptr<std::ofstream>> &files)
+ *
+ * Description          - Writes every hit of a query that was not the best
+ *                        hit for its database, then releases them
+ *
+ * Notes                - Used by out of core parsing
+ *
+ * @param query         - Query with all of its alignments added
+ * @param jobs          - One entry per DIAMOND file
+ * @param files         - Unselected hits file of each database
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::write_unselected_hits(QuerySequence *query, std::vector<DiamondParseJob> &jobs,
+                                             std::vector<std::unique_ptr<std::ofstream>> &files) {
+    QuerySequence::align_database_hits_t *alignment_data;
+
+    for (uint32 i = 0; i < jobs.size(); i++) {
+        alignment_data = query->get_database_hits(jobs[i].path, SIMILARITY_SEARCH);
+        if (alignment_data == nullptr) continue;
+        for (QueryAlignment *hit : alignment_data->hits) {
+            if (hit != alignment_data->best_hit) {
+                *files[i] << hit->print_tsv(DEFAULT_HEADERS) << '\n';
+            }
+        }
+    }
+    query->drop_unselected_hits<SimSearchAlignment>(*_pQUERY_DATA->get_alignment_pool());
+}
+
+/**
+ * ======================================================================
+ * Function std::string SimilaritySearch::get_processed_dir(const std::string &database_path)
+ *
+ * Description          - Returns processed output directory of a database
+ *
+ * Notes                - Read only, safe from concurrent statistics jobs
+ *
+ * @param database_path - DIAMOND output file of database
+ *
+ * @return              - Directory path
+ * ======================================================================
+ */
+std::string SimilaritySearch::get_processed_dir(const std::string &database_path) {
+    std::unordered_map<std::string,std::string>::const_iterator it = _file_to_database.find(database_path);
+    return PATHS(_processed_path, it != _file_to_database.end() ? it->second : "");
+}
+
+std::string SimilaritySearch::calculate_best_stats (bool is_final, std::string database_path) {
 
     GraphingData                graphingStruct;
     std::string                 species;
@@ -467,8 +1566,9 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
         database_shortname = "";
     } else {
         // Individual database results
-        database_shortname = _file_to_database[database_path];
-        base_path   = PATHS(_processed_path, database_shortname);
+        std::unordered_map<std::string,std::string>::const_iterator it = _file_to_database.find(database_path);
+        if (it != _file_to_database.end()) database_shortname = it->second;
+        base_path   = get_processed_dir(database_path);
     }
     figure_base = PATHS(base_path, FIGURE_DIR);
     _pFileSystem->create_dir(base_path);
@@ -541,7 +1641,7 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
     print_header(file_best_contam_tsv);
     print_header(file_best_hits_tsv);
     print_header(file_best_hits_tsv_no_contam);
-    print_header(file_unselected_hits);
+    if (_memory_budget == 0) print_header(file_unselected_hits);   // Otherwise written while merging runs
 
 
     try {
@@ -550,24 +1650,25 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
         graph_sum_file     << "Category\tCount"    << std::endl;
 
         // Cycle through all sequences
-        for (auto &pair : *_pQUERY_DATA->get_sequences_ptr()) {
+        for (QuerySequence *query_seq : *_pQUERY_DATA->get_sequences_ptr()) {
             // Check if original sequences have hit a database
-            if (!pair.second->hit_database(database_path, SIMILARITY_SEARCH)) {
+            if (!query_seq->hit_database(database_path, SIMILARITY_SEARCH)) {
                 // Did NOT hit a database during sim search
                 // Do NOT log if it was never blasted
-                if ((pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_IS_PROTEIN) && _blastp) ||
-                        (!pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_IS_PROTEIN) && !_blastp)) {
+                if ((query_seq->QUERY_FLAG_GET(QuerySequence::QUERY_IS_PROTEIN) && _blastp) ||
+                        (!query_seq->QUERY_FLAG_GET(QuerySequence::QUERY_IS_PROTEIN) && !_blastp)) {
                     // Protein/nucleotide did not hit database
                     count_no_hit++;
-                    file_no_hits_nucl << pair.second->get_sequence_n() << std::endl;
-                    file_no_hits_prot << pair.second->get_sequence_p() << std::endl;
+                    file_no_hits_nucl << query_seq->get_sequence_n() << std::endl;
+                    file_no_hits_prot << query_seq->get_sequence_p() << std::endl;
                     // Graphing
-                    frame = pair.second->getFrame();
+                    frame = query_seq->getFrame();
                     if (graphing_sum_map[frame].find(NO_HIT_FLAG) != graphing_sum_map[frame].end()) {
                         graphing_sum_map[frame][NO_HIT_FLAG]++;
                     } else graphing_sum_map[frame][NO_HIT_FLAG] = 1;
-                } else {
-                    pair.second->QUERY_FLAG_SET(QuerySequence::QUERY_BLASTED);
+                } else if (is_final) {
+                    // Only set on final pass, database passes run concurrently
+                    query_seq->QUERY_FLAG_SET(QuerySequence::QUERY_BLASTED);
                 }
             } else {
                 // HIT a database during sim search
@@ -576,19 +1677,21 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
                 SimSearchAlignment *best_hit;
                 // Process unselected hits for non-final analysis and set best hit pointer
                 if (is_final) {
-                    best_hit = pair.second->get_best_hit_alignment<SimSearchAlignment>(SIMILARITY_SEARCH,"");
+                    best_hit = query_seq->get_best_hit_alignment<SimSearchAlignment>(SIMILARITY_SEARCH,"");
                     sim_search_data = best_hit->get_results();
                 } else {
-                    best_hit = pair.second->get_best_hit_alignment<SimSearchAlignment>(
+                    best_hit = query_seq->get_best_hit_alignment<SimSearchAlignment>(
                             SIMILARITY_SEARCH,database_path);
                     QuerySequence::align_database_hits_t *alignment_data =
-                            pair.second->get_database_hits(database_path,SIMILARITY_SEARCH);
+                            query_seq->get_database_hits(database_path,SIMILARITY_SEARCH);
                     sim_search_data = best_hit->get_results();
-                    for (auto &hit : alignment_data->second) {
-                        count_TOTAL_alignments++;
+                    // Hits dropped by retention are counted but not written
+                    count_TOTAL_alignments += alignment_data->hit_count;
+                    count_unselected += alignment_data->hit_count - 1;
+                    for (auto &hit : alignment_data->hits) {
+                        if (_memory_budget > 0) break;  // Written while merging runs
                         if (hit != best_hit) {  // If this hit is not the best hit
                             file_unselected_hits << hit->print_tsv(DEFAULT_HEADERS) << std::endl;
-                            count_unselected++;
                         } else {
                             ;   // Do notthing
                         }
@@ -596,21 +1699,21 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
                 }
                 count_filtered++;   // increment best hit
                 // Write to best hits files
-                file_best_hits_fa_nucl << pair.second->get_sequence_n()<<std::endl;
-                file_best_hits_fa_prot << pair.second->get_sequence_p()<<std::endl;
+                file_best_hits_fa_nucl << query_seq->get_sequence_n()<<std::endl;
+                file_best_hits_fa_prot << query_seq->get_sequence_p()<<std::endl;
                 file_best_hits_tsv << best_hit->print_tsv(DEFAULT_HEADERS) << std::endl;
 
-                frame = pair.second->getFrame();     // Used for graphing
-                species = sim_search_data->species;
+                frame = query_seq->getFrame();     // Used for graphing
+                species = SYMBOL_TABLE.get(sim_search_data->species);
 
                 // Determine contaminant information and print to files
                 if (sim_search_data->contaminant) {
                     // Species is considered a contaminant
                     count_contam++;
-                    file_best_contam_fa_nucl << pair.second->get_sequence_n()<<std::endl;
-                    file_best_contam_fa_prot << pair.second->get_sequence_p()<<std::endl;
+                    file_best_contam_fa_nucl << query_seq->get_sequence_n()<<std::endl;
+                    file_best_contam_fa_prot << query_seq->get_sequence_p()<<std::endl;
                     file_best_contam_tsv << best_hit->print_tsv(DEFAULT_HEADERS) << std::endl;
-                    contam = sim_search_data->contam_type;
+                    contam = SYMBOL_TABLE.get(sim_search_data->contam_type);
                     if (contam_map.count(contam)) {
                         contam_map[contam]++;
                     } else contam_map[contam] = 1;
@@ -619,8 +1722,8 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
                     } else contam_species_map[species] = 1;
                 } else {
                     // Species is NOT a contaminant, print to files
-                    file_best_hits_fa_nucl_no_contam << pair.second->get_sequence_n()<<std::endl;
-                    file_best_hits_fa_prot_no_contam << pair.second->get_sequence_p()<<std::endl;
+                    file_best_hits_fa_nucl_no_contam << query_seq->get_sequence_n()<<std::endl;
+                    file_best_hits_fa_prot_no_contam << query_seq->get_sequence_p()<<std::endl;
                     file_best_hits_tsv_no_contam << best_hit->print_tsv(DEFAULT_HEADERS) << std::endl;
                 }
 
@@ -678,6 +1781,9 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
            "\n\tTotal alignments: "               << count_TOTAL_alignments   <<
            "\n\tTotal unselected results: "       << count_unselected      <<
            "\n\t\tWritten to: "                   << out_unselected_tsv;
+        if (_retain_hits != QuerySequence::RETAIN_ALL) {
+            ss << "\n\t\tOnly the top " << _retain_hits << " alignments of each transcript were kept";
+        }
     }
 
     // If overall alignments are 0, then throw error
@@ -689,9 +1795,7 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
     // If no total or filealignments for this database, return and warn user
     if (!is_final && (count_TOTAL_alignments == 0 || count_filtered == 0)) {
         ss << "WARNING: No alignments for this database";
-        std::string out_msg = ss.str() + "\n";
-        _pFileSystem->print_stats(out_msg);
-        return;
+        return ss.str() + "\n";
     }
 
     std::vector<count_pair> contam_species_vect(contam_species_map.begin(), contam_species_map.end());
@@ -776,7 +1880,6 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
         ct++;
     }
     std::string out_msg = ss.str() + "\n";
-    _pFileSystem->print_stats(out_msg);
 
 
     // ------------------------------------------------------------------ //
@@ -806,49 +1909,260 @@ void SimilaritySearch::calculate_best_stats (bool is_final, std::string database
 
     // check if final - different graph
     // ************************************ //
+    return out_msg;
+}
+
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::split_lineage(const std::string &lineage,
+ *                                    std::vector<SymbolTable::symbol_t> &ancestors)
+ *
+ * Description          - Splits a lineage (species;genus;...;root) into
+ *                        interned ancestor IDs, so lineages can be compared
+ *                        as integer sets
+ *
+ * Notes                - Lineage is lowercased
+ *
+ * @param lineage       - Lineage from taxonomic database
+ * @param ancestors     - Set to ancestor IDs, in lineage order
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::split_lineage(const std::string &lineage, std::vector<SymbolTable::symbol_t> &ancestors) {
+    std::string lower = lineage;
+    uint64      start = 0;
+    uint64      end;
+
+    LOWERCASE(lower);
+    ancestors.clear();
+    if (lower.empty()) return;
+    while ((end = lower.find(LINEAGE_DELIM, start)) != std::string::npos) {
+        ancestors.push_back(SYMBOL_TABLE.intern(lower.substr(start, end - start)));
+        start = end + 1;
+    }
+    ancestors.push_back(SYMBOL_TABLE.intern(lower.substr(start)));
 }
 
-std::pair<bool,std::string> SimilaritySearch::is_contaminant(std::string lineage, tax_serial_map_t &database,
-                    std::vector<std::string> &contams) {
-    // species and tax database both lowercase
-    if (contams.empty()) return std::pair<bool,std::string>(false,"");
-    LOWERCASE(lineage);
-    for (auto const &contaminant:contams) {
-        if (lineage.find(contaminant) != std::string::npos){
-            return std::pair<bool,std::string>(true,contaminant);
+/**
+ * ======================================================================
+ * Function const SimilaritySearch::LineageInfo &SimilaritySearch::get_lineage_info(
+ *                                                  SymbolTable::symbol_t lineage)
+ *
+ * Description          - Returns contaminant status and number of ancestors
+ *                        shared with the target species for a lineage
+ *                      - Checked against the ancestor ID sets of the target
+ *                        lineage and user contaminants, once per distinct
+ *                        lineage
+ *
+ * Notes                - Contaminant reported is the first one (in user
+ *                        order) found in the lineage
+ *                      - The last lineage entry (root) is not counted as a
+ *                        shared ancestor
+ *
+ * @param lineage       - Interned lineage of alignment
+ *
+ * @return              - Lineage information
+ * ======================================================================
+ */
+const SimilaritySearch::LineageInfo &SimilaritySearch::get_lineage_info(SymbolTable::symbol_t lineage) {
+    std::vector<SymbolTable::symbol_t> ancestors;
+    LineageInfo                        info;
+    uint64                             contam_index;
+
+    std::unordered_map<SymbolTable::symbol_t, LineageInfo>::iterator it = _lineage_cache.find(lineage);
+    if (it != _lineage_cache.end()) return it->second;
+
+    info.shared_ancestors = 0;
+    info.contaminant      = false;
+    info.contam_type      = SymbolTable::SYMBOL_EMPTY;
+    contam_index          = _contaminants.size();
+
+    split_lineage(SYMBOL_TABLE.get(lineage), ancestors);
+    for (uint64 i = 0; i < ancestors.size(); i++) {
+        if (i + 1 < ancestors.size() && _input_ancestors.find(ancestors[i]) != _input_ancestors.end()) {
+            info.shared_ancestors++;
         }
+        std::unordered_map<SymbolTable::symbol_t, uint64>::iterator contam = _contaminant_ancestors.find(ancestors[i]);
+        if (contam != _contaminant_ancestors.end() && contam->second < contam_index) {
+            contam_index = contam->second;
+        }
+    }
+    if (contam_index < _contaminants.size()) {
+        info.contaminant = true;
+        info.contam_type = SYMBOL_TABLE.intern(_contaminants[contam_index]);
     }
-    return std::pair<bool,std::string>(false,"");
+    return _lineage_cache.emplace(lineage, info).first->second;
 }
 
-std::string SimilaritySearch::get_species(std::string &title) {
-    // TODO use regex(database specific)
+/**
+ * ======================================================================
+ * Function void SimilaritySearch::set_percent_identity(const char *pident,
+ *                                                      SimSearchResults &results)
+ *
+ * Description          - Stores DIAMOND percent identity as a number along
+ *                        with the number of decimals it was printed with,
+ *                        so output matches the DIAMOND text exactly
+ *
+ * Notes                - None
+ *
+ * @param pident        - Percent identity column text
+ * @param results       - Results to update
+ *
+ * @return              - None
+ * ======================================================================
+ */
+void SimilaritySearch::set_percent_identity(const char *pident, SimSearchResults &results) {
+    const char *decimal;
+
+    results.pident = (fp32) strtod(pident, nullptr);
+    results.pident_precision = 0;
+    decimal = strchr(pident, '.');
+    if (decimal != nullptr) {
+        while (isdigit(*++decimal)) results.pident_precision++;
+    }
+}
 
+/**
+ * ======================================================================
+ * Function std::string SimilaritySearch::get_species(DiamondParseJob &job,
+ *                                    const std::string &sseqid, const std::string &title)
+ *
+ * Description          - Pulls species from a database alignment title
+ *                        using the scanners for the supported database
+ *                        formats (UniProt, NCBI)
+ *                      - Species are cached by subject ID since the same
+ *                        subjects are hit by many queries
+ *
+ * Notes                - Cache is kept per DIAMOND file (job)
+ *
+ * @param job           - Job of DIAMOND file being parsed
+ * @param sseqid        - Subject ID of alignment
+ * @param title         - Subject title of alignment
+ *
+ * @return              - Species (empty if not found)
+ * ======================================================================
+ */
+std::string SimilaritySearch::get_species(DiamondParseJob &job, const std::string &sseqid, const std::string &title) {
     std::string species;
-    boost::smatch match;
 
-    boost::regex ncbi_exp(_NCBI_REGEX);
-    boost::regex uniprot_exp(_UNIPROT_REGEX);
+    std::unordered_map<std::string,std::string>::iterator it = job.species_cache.find(sseqid);
+    if (it != job.species_cache.end()) return it->second;
 
-    species = "";
-    if (boost::regex_search(title,match,uniprot_exp)) {
-        species = std::string(match[1].first, match[1].second);
-    } else {
-        if (boost::regex_search(title, match, ncbi_exp))
-            species = std::string(match[1].first, match[1].second);
+    for (species_scanner_t scanner : _species_scanners) {
+        if (scanner(title, species)) break;
     }
     // Double bracket fix
-    if (species[0] == '[') species = species.substr(1);
-    if (species[species.length()-1] == ']') species = species.substr(0,species.length()-1);
+    if (!species.empty() && species[0] == '[') species = species.substr(1);
+    if (!species.empty() && species[species.length()-1] == ']') species = species.substr(0,species.length()-1);
+
+    if (job.species_cache.size() >= SPECIES_CACHE_MAX) job.species_cache.clear();
+    job.species_cache.emplace(sseqid, species);
     return species;
 }
 
-bool SimilaritySearch::is_informative(std::string title) {
-    LOWERCASE(title);
-    for (std::string &item : _uninformative_vect) { // Already lowercase
-        if (title.find(item) != std::string::npos) return false;
+/**
+ * ======================================================================
+ * Function bool SimilaritySearch::scan_species_uniprot(const std::string &title,
+ *                                                      std::string &species)
+ *
+ * Description          - UniProt titles: species follows "OS=" and runs up
+ *                        to the next " XX=" tag (same as "OS=(.+?)\s\S\S=")
+ *
+ * Notes                - Only the first "OS=" needs to be checked, any later
+ *                        one can only see the same tags
+ *
+ * @param title         - Subject title of alignment
+ * @param species       - Set to species if found
+ *
+ * @return              - True if title is UniProt format
+ * ======================================================================
+ */
+bool SimilaritySearch::scan_species_uniprot(const std::string &title, std::string &species) {
+    uint64 name;
+
+    name = title.find(UNIPROT_SPECIES_TAG);
+    if (name == std::string::npos) return false;
+    name += UNIPROT_SPECIES_TAG.length();
+
+    for (uint64 i = name + 1; i + 3 < title.length(); i++) {
+        if (isspace((unsigned char) title[i]) &&
+            !isspace((unsigned char) title[i+1]) &&
+            !isspace((unsigned char) title[i+2]) &&
+            title[i+3] == '=') {
+            species.assign(title, name, i - name);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * ======================================================================
+ * Function bool SimilaritySearch::scan_species_ncbi(const std::string &title,
+ *                                                   std::string &species)
+ *
+ * Description          - NCBI titles: species is within the last set of
+ *                        brackets (same as "\[([^]]+)\](?!.+\[.+\])")
+ *
+ * Notes                - A bracketed name is skipped if another bracket
+ *                        pair begins at least two characters after it
+ *
+ * @param title         - Subject title of alignment
+ * @param species       - Set to species if found
+ *
+ * @return              - True if title is NCBI format
+ * ======================================================================
+ */
+bool SimilaritySearch::scan_species_ncbi(const std::string &title, std::string &species) {
+    uint64 last_close;
+    uint64 close;
+    uint64 next;
+
+    last_close = title.rfind(']');
+    if (last_close == std::string::npos) return false;
+
+    for (uint64 open = title.find('['); open != std::string::npos; open = title.find('[', open + 1)) {
+        close = title.find(']', open + 1);
+        if (close == std::string::npos) return false;
+        if (close == open + 1) continue;    // Empty brackets
+        next = title.find('[', close + 2);
+        if (next != std::string::npos && next + 2 <= last_close) continue;
+        species.assign(title, open + 1, close - open - 1);
+        return true;
     }
-    return true;
+    return false;
+}
+
+/**
+ * ======================================================================
+ * Function bool SimilaritySearch::is_informative(DiamondParseJob &job,
+ *                                    const std::string &sseqid, const std::string &title)
+ *
+ * Description          - Checks whether an alignment title contains any
+ *                        uninformative term
+ *                      - All terms are searched in one pass with the
+ *                        case-insensitive uninformative matcher
+ *
+ * Notes                - Cached by subject ID per DIAMOND file (job)
+ *
+ * @param job           - Job of DIAMOND file being parsed
+ * @param sseqid        - Subject ID of alignment
+ * @param title         - Subject title of alignment
+ *
+ * @return              - True if informative
+ * ======================================================================
+ */
+bool SimilaritySearch::is_informative(DiamondParseJob &job, const std::string &sseqid, const std::string &title) {
+    bool informative;
+
+    std::unordered_map<std::string,bool>::iterator it = job.informative_cache.find(sseqid);
+    if (it != job.informative_cache.end()) return it->second;
+
+    informative = !_uninformative_matcher.matches(title);
+    if (job.informative_cache.size() >= SPECIES_CACHE_MAX) job.informative_cache.clear();
+    job.informative_cache.emplace(sseqid, informative);
+    return informative;
 }
 
 void SimilaritySearch::print_header(std::ofstream &file_stream) {
@@ -32,19 +32,67 @@
 #include <iostream>
 #include <list>
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 #include <boost/program_options/variables_map.hpp>
 #include "QuerySequence.h"
 #include "GraphingManager.h"
 #include "QueryData.h"
+#include "PatternMatcher.h"
 #include "database/EntapDatabase.h"
 
 //**************************************************************
 
+class AlignmentRuns;
 
 class SimilaritySearch {
 
     typedef std::map<std::string,std::map<std::string,uint32>> graph_sum_t;
+    typedef bool (*species_scanner_t)(const std::string&, std::string&);
+
+    struct StagedRows {
+        std::vector<std::pair<SimSearchResults,std::string>>    rows;       // results, species (file order)
+        std::unordered_set<std::string>                         species;    // Species to resolve
+    };
+
+    struct DiamondParseJob {
+        std::string                                             path;       // DIAMOND output file
+        uint32                                                  index;      // Database search order
+        std::unique_ptr<AlignmentRuns>                          runs;       // Out of core rows, if enabled
+        StagedRows                                              staged;     // Batch being read
+        std::deque<StagedRows>                                  batches;    // Read, waiting to be merged
+        std::mutex                                              lock;       // Guards batches, done, abort
+        std::condition_variable                                 batch_cond;
+        bool                                                    merge_inline = false;  // Reader merges
+        bool                                                    done = false;
+        bool                                                    abort = false;
+        std::unordered_map<std::string,std::string>             species_cache;      // sseqid -> species
+        std::unordered_map<std::string,bool>                    informative_cache;  // sseqid -> informativeness
+        std::string                                             stats;      // Statistics for log file
+        std::string                                             error;      // Set if job failed
+    };
+
+    typedef void (SimilaritySearch::*diamond_job_t)(DiamondParseJob*);
+
+    struct DiamondSearch {
+        std::string input;      // Query FASTA (transcriptome or shard)
+        std::string database;   // DIAMOND database path
+        std::string out_path;   // DIAMOND output file
+        std::string std_out;    // Std out/err path
+        uint64      size;       // Database size (bytes), used to split threads
+        int         threads;    // Threads given to this search
+        std::string error;      // Set if search failed
+    };
+
+    struct LineageInfo {
+        uint16                shared_ancestors;   // Ancestors in common with target species
+        bool                  contaminant;
+        SymbolTable::symbol_t contam_type;
+    };
 
 public:
 
@@ -54,13 +102,17 @@ public:
     SimilaritySearch();
     void parse_files(std::string);
     static bool is_executable();
+
+    static const std::string DMND_FAST;             // DIAMOND sensitivity modes
+    static const std::string DMND_SENSITIVE;
+    static const std::string DMND_MORE_SENSITIVE;
     //**************************************************************
 
 
 private:
 
-    const std::string _NCBI_REGEX                                = "\\[([^]]+)\\](?!.+\\[.+\\])";
-    const std::string _UNIPROT_REGEX                             = "OS=(.+?)\\s\\S\\S=";
+    static const std::string UNIPROT_SPECIES_TAG;
+
     const std::string SIM_SEARCH_DATABASE_BEST_TSV               = "best_hits.tsv";
     const std::string SIM_SEARCH_DATABASE_BEST_TSV_NO_CONTAM     = "best_hits_no_contam.tsv";
     const std::string SIM_SEARCH_DATABASE_BEST_FA_NUCL           = "best_hits.fnn";
@@ -75,6 +127,9 @@ private:
     const std::string SIM_SEARCH_DATABASE_NO_HITS_PROT           = "no_hits.faa";
     const std::string SIM_SEARCH_DATABASE_UNSELECTED             = "unselected.tsv";
     const std::string SIM_SEARCH_DIR                             = "similarity_search/";
+    const std::string SHARD_DIR                                  = "shards/";
+    const std::string SHARD_TAG                                  = "_shard_";
+    const std::string CASCADE_NO_HITS_TAG                        = "_cascade_no_hits";
     const std::string PROCESSED_DIR                              = "processed/";
     const std::string RESULTS_DIR                                = "overall_results/";
     const std::string FIGURE_DIR                                 = "figures/";
@@ -101,6 +156,13 @@ private:
 
     static constexpr int DMND_COL_NUMBER = 14;
     static constexpr short COUNT_TOP_SPECIES = 20;
+    static constexpr uint32 SPECIES_CACHE_MAX = 1 << 16;
+    static constexpr char LINEAGE_DELIM = ';';
+    static constexpr uint64 RUN_BUDGET_MIN = 1 << 20;   // Bytes buffered per parse worker
+    static constexpr uint64 STAGE_BATCH_ROWS = 1 << 16;     // Rows staged before a merge
+    static constexpr uint64 STAGE_BATCH_SPECIES = 1 << 12;  // Species staged before a merge
+    static constexpr uint64 STAGE_QUEUE_BATCHES = 4;        // Batches a reader runs ahead
+    const std::string SIM_SEARCH_RUN_PREFIX                      = "dmnd_alignments_";
 
     const std::vector<const std::string*> DEFAULT_HEADERS {
             &ENTAP_EXECUTE::HEADER_QUERY,
@@ -125,11 +187,12 @@ private:
 
     std::vector<std::string>        _database_paths;
     std::vector<std::string>        _sim_search_paths;
-    std::vector<std::string>        _uninformative_vect;
+    PatternMatcher                  _uninformative_matcher;
     std::string                     _diamond_exe;
     std::string                     _outpath;
     std::string                     _input_path;
     std::string                     _sim_search_dir;
+    std::string                     _shard_dir;
     std::string                     _processed_path;
     std::string                     _figure_path;
     std::string                     _results_path;
@@ -140,6 +203,12 @@ private:
     int                             _threads;
     bool                            _overwrite;
     bool                            _blastp;
+    bool                            _stream_results;  // Parse DIAMOND output as it is produced
+    uint32                          _retain_hits;     // Alignments kept per query and database (0 = all)
+    uint64                          _memory_budget;   // Bytes for out of core parsing (0 = in memory)
+    uint32                          _diamond_jobs;    // DIAMOND searches run at the same time
+    uint32                          _query_shards;    // Transcriptome shards searched separately
+    std::string                     _cascade_mode;    // Sensitivity of no hit rerun (empty = no cascade)
     fp64                            _e_val;
     fp32                            _qcoverage;
     fp32                            _tcoverage;
@@ -151,16 +220,54 @@ private:
     UserInput                       *_pUserInput;
     EntapDatabase                   *_pEntapDatabase;
     std::unordered_map<std::string,std::string> _file_to_database;
+    std::unordered_set<std::string> _streamed_paths;   // Output files already parsed during execution
+    std::vector<species_scanner_t>  _species_scanners; // Species parsers for database title formats
+    std::unordered_set<SymbolTable::symbol_t>   _input_ancestors;  // Interned target lineage
+    std::unordered_map<SymbolTable::symbol_t,uint64> _contaminant_ancestors; // Contaminant -> index
+    std::unordered_map<SymbolTable::symbol_t,LineageInfo> _lineage_cache;  // Lineage -> info
+    std::unordered_map<std::string,std::pair<SymbolTable::symbol_t,SymbolTable::symbol_t>> _taxonomy_cache; // Species -> species, lineage
 
     std::vector<std::string> diamond();
-    void diamond_blast(std::string, std::string, std::string,std::string&,int&, std::string&);
+    void diamond_blast(std::string, std::string, std::string,std::string&,int&, std::string&,
+                       const std::string& = DMND_MORE_SENSITIVE);
+    void diamond_stream(std::string, std::string, std::string,std::string&,int&, std::string&, bool=true);
+    void diamond_cascade(DiamondSearch&);
+    uint64 write_cascade_queries(std::string&, std::string&, std::string&);
+    void run_diamond_search(DiamondSearch&, bool);
+    void run_diamond_searches(std::vector<DiamondSearch>&);
+    void diamond_search_job(DiamondSearch*);
+    std::vector<std::string> split_query_shards();
+    void merge_diamond_outputs(std::vector<std::string>&, std::string&);
+    std::string get_shard_name(uint32, uint32);
+    std::string diamond_cmd(std::string&, std::string&, int&, std::string&, const std::string& = DMND_MORE_SENSITIVE);
     std::vector<std::string> verify_diamond_files();
-    void diamond_parse(std::vector<std::string>&);
-    std::pair<bool,std::string> is_contaminant(std::string, tax_serial_map_t&,std::vector<std::string>&);
-    bool is_informative(std::string);
+    void diamond_parse();
+    template<class Reader>
+    void diamond_parse_rows(Reader&, std::string&);
+    template<class Reader>
+    void diamond_stage_rows(Reader&, DiamondParseJob&);
+    void flush_staged_rows(DiamondParseJob&);
+    void diamond_merge_rows(DiamondParseJob&, StagedRows&);
+    void merge_staged_batches(std::vector<DiamondParseJob>&);
+    void diamond_parse_runs(std::vector<DiamondParseJob>&);
+    void diamond_merge_runs(std::vector<DiamondParseJob>&);
+    void write_unselected_hits(QuerySequence*, std::vector<DiamondParseJob>&,
+                               std::vector<std::unique_ptr<std::ofstream>>&);
+    void set_taxonomy(SimSearchResults&, std::string&);
+    std::string get_processed_dir(const std::string&);
+    void diamond_parse_job(DiamondParseJob*);
+    void diamond_stats_job(DiamondParseJob*);
+    void run_diamond_jobs(diamond_job_t, std::vector<DiamondParseJob>&);
+    void diamond_job_worker(diamond_job_t, std::vector<DiamondParseJob>*, std::atomic<uint32>*);
+    void split_lineage(const std::string&, std::vector<SymbolTable::symbol_t>&);
+    const LineageInfo &get_lineage_info(SymbolTable::symbol_t);
+    bool is_informative(DiamondParseJob&, const std::string&, const std::string&);
     void print_header(std::ofstream&);
-    std::string get_species(std::string &title);
-    void calculate_best_stats (bool,std::string="");
+    std::string get_species(DiamondParseJob&, const std::string&, const std::string&);
+    static bool scan_species_uniprot(const std::string&, std::string&);
+    static bool scan_species_ncbi(const std::string&, std::string&);
+    void set_percent_identity(const char*, SimSearchResults&);
+    std::string calculate_best_stats (bool,std::string="");
     std::string get_database_shortname(std::string&);
     std::string get_transcriptome_shortname();
 
@@ -0,0 +1,121 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdexcept>
+#include "SymbolTable.h"
+
+SymbolTable SYMBOL_TABLE;
+
+constexpr SymbolTable::symbol_t SymbolTable::SYMBOL_EMPTY;
+constexpr uint32 SymbolTable::CHUNK_BASE_BITS;
+
+SymbolTable::SymbolTable() : _size(0) {
+    for (std::atomic<slot_t*> &chunk : _chunks) chunk.store(nullptr, std::memory_order_relaxed);
+    _index.reserve(INITIAL_SIZE);
+    intern("");
+}
+
+SymbolTable::~SymbolTable() {
+    for (std::atomic<slot_t*> &chunk : _chunks) delete[] chunk.load(std::memory_order_relaxed);
+}
+
+/**
+ * ======================================================================
+ * Function SymbolTable::symbol_t SymbolTable::intern(const std::string &value)
+ *
+ * Description          - Returns the handle for a string, adding it to
+ *                        the table if it has not been seen before
+ *
+ * Notes                - Thread safe. Callers interning the same strings
+ *                        for many rows should keep their own cache
+ *
+ * @param value         - String to intern
+ *
+ * @return              - Handle for value
+ *
+ * =====================================================================
+ */
+SymbolTable::symbol_t SymbolTable::intern(const std::string &value) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32 chunk;
+    uint64 offset;
+    symbol_t symbol = _size.load(std::memory_order_relaxed);
+
+    std::pair<std::unordered_map<std::string, symbol_t>::iterator, bool> result =
+            _index.emplace(value, symbol);
+    if (result.second) {
+        locate(symbol, chunk, offset);
+        slot_t *slots = _chunks[chunk].load(std::memory_order_relaxed);
+        if (slots == nullptr) {
+            slots = new slot_t[(uint64) 1 << (CHUNK_BASE_BITS + chunk)];
+            _chunks[chunk].store(slots, std::memory_order_release);
+        }
+        // Keys of unordered_map nodes do not move on rehash
+        slots[offset].store(&result.first->first, std::memory_order_release);
+        _size.store(symbol + 1, std::memory_order_release);
+    }
+    return result.first->second;
+}
+
+/**
+ * ======================================================================
+ * Function const std::string &SymbolTable::get(symbol_t symbol) const
+ *
+ * Description          - Resolves a handle back to its string
+ *
+ * Notes                - Thread safe and lock free
+ *                      - Throws std::out_of_range for unknown handles
+ *
+ * @param symbol        - Handle returned from intern
+ *
+ * @return              - Interned string
+ *
+ * =====================================================================
+ */
+const std::string &SymbolTable::get(symbol_t symbol) const {
+    uint32 chunk;
+    uint64 offset;
+
+    if (symbol >= _size.load(std::memory_order_acquire)) {
+        throw std::out_of_range("Unknown symbol: " + std::to_string(symbol));
+    }
+    locate(symbol, chunk, offset);
+    return *_chunks[chunk].load(std::memory_order_acquire)[offset].load(std::memory_order_acquire);
+}
+
+uint32 SymbolTable::size() const {
+    return _size.load(std::memory_order_acquire);
+}
+
+// Chunk k covers handles [2^(12+k) - 2^12, 2^(13+k) - 2^12)
+void SymbolTable::locate(symbol_t symbol, uint32 &chunk, uint64 &offset) {
+    uint64 value = (uint64) symbol + ((uint64) 1 << CHUNK_BASE_BITS);
+
+    for (chunk = 0; (value >> (CHUNK_BASE_BITS + chunk + 1)) != 0; chunk++);
+    offset = value - ((uint64) 1 << (CHUNK_BASE_BITS + chunk));
+}
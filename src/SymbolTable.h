@@ -0,0 +1,82 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENTAP_SYMBOLTABLE_H
+#define ENTAP_SYMBOLTABLE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "common.h"
+
+/*
+ * Interns strings that repeat across many alignments (database paths,
+ * species, lineages, contaminant types). Each distinct string is stored
+ * once and referred to by a 32-bit handle, so handles can be compared
+ * directly and only resolved when output is written.
+ *
+ * Handles and the strings they resolve to stay valid for the whole run.
+ * Interning takes a lock, resolving a handle does not: handle slots live
+ * in chunks that never move once allocated (chunk k holds 2^(12+k)
+ * handles), and each slot is published with release ordering.
+ */
+class SymbolTable {
+
+public:
+    typedef uint32 symbol_t;
+
+    static constexpr symbol_t SYMBOL_EMPTY = 0;     // Always the empty string
+
+    SymbolTable();
+    ~SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    symbol_t intern(const std::string&);
+    const std::string &get(symbol_t) const;
+    uint32 size() const;
+
+private:
+    typedef std::atomic<const std::string*> slot_t;
+
+    static constexpr uint32 INITIAL_SIZE = 4096;
+    static constexpr uint32 CHUNK_BASE_BITS = 12;   // First chunk holds 2^12 handles
+    static constexpr uint32 CHUNK_COUNT = 21;       // Enough for every 32-bit handle
+
+    static void locate(symbol_t, uint32&, uint64&);
+
+    mutable std::mutex                          _mutex;
+    std::unordered_map<std::string, symbol_t>   _index;     // Owns the strings
+    std::atomic<slot_t*>                        _chunks[CHUNK_COUNT];   // Handle -> key in _index
+    std::atomic<uint32>                         _size;
+};
+
+extern SymbolTable SYMBOL_TABLE;
+
+
+#endif //ENTAP_SYMBOLTABLE_H
@@ -181,6 +181,29 @@
 #define DESC_NOCHECK        "Use this flag if you don't want your input to EnTAP verifed."\
                             " This is not advised to use! Your run may fail later on "  \
                             "if inputs are not checked"
+#define DESC_DMND_STREAM    "Parse DIAMOND results as they are produced instead of "   \
+                            "waiting for each search to finish. A copy of the results " \
+                            "is still written to the similarity search directory"
+#define DESC_RETAIN_HITS    "Number of alignments to keep for each transcript against "\
+                            "each database during similarity searching. The best hit " \
+                            "is always kept. Default (0) keeps every alignment, 1 only "\
+                            "keeps the best hit. Dropped alignments are not written to "\
+                            "the unselected hits file"
+#define DESC_SIM_MEMORY     "Memory (in MB) to use when parsing similarity search "    \
+                            "results. When set, alignments are sorted to disk and "    \
+                            "merged back one transcript at a time, so very large "     \
+                            "searches stay within this budget. Default (0) keeps all " \
+                            "alignments in memory"
+#define DESC_DMND_JOBS      "Number of DIAMOND searches to run at once when several "  \
+                            "databases are selected. Threads are split between "       \
+                            "searches by database size"
+#define DESC_DMND_SHARDS    "Split the transcriptome into this many shards, balanced "  \
+                            "by residue count, and search each shard on its own. "     \
+                            "Finished shards are kept, so an interrupted search "      \
+                            "resumes from the first unfinished shard"
+#define DESC_DMND_CASCADE   "Search every query in DIAMOND fast mode first, then search "\
+                            "queries without a hit again at this sensitivity "         \
+                            "(sensitive or more-sensitive)"
 //**************************************************************
 std::string RSEM_EXE_DIR;
 std::string GENEMARK_EXE;
@@ -261,6 +284,16 @@ void UserInput::parse_arguments_boost(int argc, const char** argv) {
                 ("input,i", boostPO::value<std::string>(), DESC_INPUT_TRAN)
                 (UInput::INPUT_FLAG_COMPLETE.c_str(), DESC_COMPLET_PROT)
                 (UInput::INPUT_FLAG_NOCHECK.c_str(), DESC_NOCHECK)
+                (UInput::INPUT_FLAG_DMND_STREAM.c_str(), DESC_DMND_STREAM)
+                (UInput::INPUT_FLAG_RETAIN_HITS.c_str(),
+                 boostPO::value<int>()->default_value(QuerySequence::RETAIN_ALL), DESC_RETAIN_HITS)
+                (UInput::INPUT_FLAG_SIM_MEMORY.c_str(),
+                 boostPO::value<int>()->default_value(0), DESC_SIM_MEMORY)
+                (UInput::INPUT_FLAG_DMND_JOBS.c_str(),
+                 boostPO::value<int>()->default_value(1), DESC_DMND_JOBS)
+                (UInput::INPUT_FLAG_DMND_SHARDS.c_str(),
+                 boostPO::value<int>()->default_value(1), DESC_DMND_SHARDS)
+                (UInput::INPUT_FLAG_DMND_CASCADE.c_str(), boostPO::value<std::string>(), DESC_DMND_CASCADE)
                 (UInput::INPUT_FLAG_OVERWRITE.c_str(), DESC_OVERWRITE);
         boostPO::variables_map vm;
         try {
@@ -441,6 +474,29 @@ bool UserInput::verify_user_input() {
                 }
             }
 
+            // Verify similarity search counts (unsigned options would wrap negative input)
+            if (get_user_input<int>(UInput::INPUT_FLAG_RETAIN_HITS) < 0) {
+                throw ExceptionHandler("Retained hits must be 0 (keep all) or greater", ERR_ENTAP_INPUT_PARSE);
+            }
+            if (get_user_input<int>(UInput::INPUT_FLAG_SIM_MEMORY) < 0) {
+                throw ExceptionHandler("Similarity search memory must be 0 (in memory) or greater", ERR_ENTAP_INPUT_PARSE);
+            }
+            if (get_user_input<int>(UInput::INPUT_FLAG_DMND_JOBS) < 1) {
+                throw ExceptionHandler("DIAMOND jobs must be 1 or greater", ERR_ENTAP_INPUT_PARSE);
+            }
+            if (get_user_input<int>(UInput::INPUT_FLAG_DMND_SHARDS) < 1) {
+                throw ExceptionHandler("DIAMOND query shards must be 1 or greater", ERR_ENTAP_INPUT_PARSE);
+            }
+
+            // Verify DIAMOND cascade sensitivity
+            if (has_input(UInput::INPUT_FLAG_DMND_CASCADE)) {
+                std::string cascade = get_user_input<std::string>(UInput::INPUT_FLAG_DMND_CASCADE);
+                if (cascade != SimilaritySearch::DMND_SENSITIVE && cascade != SimilaritySearch::DMND_MORE_SENSITIVE) {
+                    throw ExceptionHandler("DIAMOND cascade sensitivity must be " + SimilaritySearch::DMND_SENSITIVE +
+                                           " or " + SimilaritySearch::DMND_MORE_SENSITIVE, ERR_ENTAP_INPUT_PARSE);
+                }
+            }
+
             // Verify Ontology Flags
             is_interpro = false;
             if (has_input(UInput::INPUT_FLAG_ONTOLOGY)) {
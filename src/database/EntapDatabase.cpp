@@ -25,16 +25,35 @@
 */
 
 #include <csv.h>
+#include <thread>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include "EntapDatabase.h"
 
 
+// Row callback for batched taxonomy lookups, keeps first row per name
+static bool sql_add_found_tax_entry(sqlite3_stmt *stmt, void *data) {
+    std::unordered_map<std::string, TaxEntry> *found = static_cast<std::unordered_map<std::string, TaxEntry>*>(data);
+    TaxEntry &entry = (*found)[SQLDatabaseHelper::column_string(stmt, 0)];
+
+    if (entry.is_empty()) {
+        entry.tax_name = SQLDatabaseHelper::column_string(stmt, 0);
+        entry.tax_id   = SQLDatabaseHelper::column_string(stmt, 1);
+        entry.lineage  = SQLDatabaseHelper::column_string(stmt, 2);
+    }
+    return true;
+}
+
+
 EntapDatabase::EntapDatabase(FileSystem* filesystem) {
     // Initialize
     _pFilesystem     = filesystem;
     _temp_directory  = filesystem->get_temp_outdir();    // created previously
     _pSerializedDatabase = nullptr;
+    _pMappedDatabase     = nullptr;
     _pDatabaseHelper     = nullptr;
     _use_serial          = true;
+    _sql_bulk_rows       = 0;
+    _threads             = 1;
 }
 
 bool EntapDatabase::set_database(DATABASE_TYPE type, std::string path) {
@@ -52,7 +71,9 @@ bool EntapDatabase::set_database(DATABASE_TYPE type, std::string path) {
             }
             if (_pDatabaseHelper != nullptr) return true;   // already generated
             _pDatabaseHelper = new SQLDatabaseHelper();
-            return _pDatabaseHelper->open(ENTAP_DATABASE_SQL_PATH);
+            if (!_pDatabaseHelper->open(ENTAP_DATABASE_SQL_PATH)) return false;
+            sql_migrate_schema();   // Still usable (slower) if migration fails
+            return true;
         default:
             return false;
     }
@@ -130,6 +151,10 @@ EntapDatabase::DATABASE_ERR EntapDatabase::generate_entap_sql(std::string &outpa
         return err_code;
     }
 
+    if (!_pDatabaseHelper->set_user_version(SQL_SCHEMA_VERSION)) {
+        return ERR_DATA_SQL_CREATE_TABLE;
+    }
+
     return ERR_DATA_OK;
 }
 
@@ -181,21 +206,16 @@ EntapDatabase::~EntapDatabase() {
     }
 
     SAFE_DELETE(_pSerializedDatabase);
+    SAFE_DELETE(_pMappedDatabase);
 }
 
 EntapDatabase::DATABASE_ERR EntapDatabase::generate_entap_tax(EntapDatabase::DATABASE_TYPE type,
                                                               std::string outpath) {
     std::string temp_outpath;   // Path to unzipped files
-    std::string sql_cmd;
-    std::stringstream ss_temp;  // just for now
-    std::string line;
     std::string ncbi_names_path;    // Path to uncompressed names file
     std::string ncbi_nodes_path;
-    vect_str_t  split_line;         // Split line by tabs
-
-    std::string tax_id;
-    std::string tax_name;
     std::string lineage;
+    std::vector<TaxDumpChunk> chunks;
 
     // logging counts
     uint64 total_entries=0;
@@ -203,9 +223,9 @@ EntapDatabase::DATABASE_ERR EntapDatabase::generate_entap_tax(EntapDatabase::DAT
     uint16 percent_complete;
     uint16 percent_prev=0;
 
-    // Instead of creating tree, just using map to access each node
-    // Keyed to NCBI ID's (first column of uncompressed files)
-    std::unordered_map<std::string, TaxonomyNode> taxonomy_nodes;
+    // Instead of creating tree, just using vector to access each node
+    // Indexed by NCBI ID's (first column of uncompressed files)
+    std::vector<TaxonomyNode> taxonomy_nodes;
 
     FS_dprint("Generating EnTAP Tax database entries...");
 
@@ -237,73 +257,61 @@ EntapDatabase::DATABASE_ERR EntapDatabase::generate_entap_tax(EntapDatabase::DAT
 
 
     FS_dprint("Parsing NCBI Names file at: " + ncbi_names_path);
-    // parse through names of taxonomy ID's and add to map
-    std::ifstream infile(ncbi_names_path);
-    while (std::getline(infile, line)) {
-        if (line == "") continue;
-        total_entries++;
-        // Split line by tabs, lazy..fix :(
-        split_line = split_string(line, NCBI_TAX_DUMP_DELIM);
-
-        tax_id = split_line[NCBI_TAX_DUMP_COL_ID];
-        tax_name   = split_line[NCBI_TAX_DUMP_COL_NAME];
-
-        // Check if map already has this entry, if not - generate
-        if (taxonomy_nodes.find(tax_id) == taxonomy_nodes.end()) {
-            taxonomy_nodes.emplace(tax_id, TaxonomyNode(tax_id));
-        }
-
-        std::unordered_map<std::string, TaxonomyNode>::iterator it = taxonomy_nodes.find(tax_id);
-
-        // We'll want to use scientific names when displaying lineage
-        if (split_line[NCBI_TAX_DUMP_COL_NAME_CLASS].compare(NCBI_TAX_DUMP_SCIENTIFIC) ==0) {
-            it->second.sci_name = tax_name;
+    // parse through names of taxonomy ID's and add to nodes
+    if (!parse_tax_dump(ncbi_names_path, &EntapDatabase::parse_tax_names_chunk, chunks)) {
+        return ERR_DATA_FILE_DECOMPRESS;
+    }
+    for (TaxDumpChunk &chunk : chunks) {
+        for (TaxDumpName &entry : chunk.names) {
+            total_entries++;
+            if (entry.tax_id >= taxonomy_nodes.size()) taxonomy_nodes.resize(entry.tax_id + 1);
+            TaxonomyNode &node = taxonomy_nodes[entry.tax_id];
+            node.ncbi_id = entry.tax_id;
+            // We'll want to use scientific names when displaying lineage
+            if (entry.scientific) node.sci_name = entry.name;
+            node.names.push_back(std::move(entry.name));
         }
-        it->second.names.push_back(tax_name);
     }
-    infile.close();
+    chunks.clear();
     FS_dprint("Success! Parsing nodes file at: " + ncbi_nodes_path);
 
     // parse through nodes file
-    std::ifstream infile_node(ncbi_nodes_path);
-    while (std::getline(infile_node, line)) {
-        if (line == "") continue;
-
-        // split line by tabs
-        split_line = split_string(line, NCBI_TAX_DUMP_DELIM);
-
-        tax_id = split_line[NCBI_TAX_DUMP_COL_ID];
-
-        // Ensure node has name associated with it
-        std::unordered_map<std::string, TaxonomyNode>::iterator it = taxonomy_nodes.find(tax_id);
-
-        // Node with no names, skip we don't want this
-        if (it == taxonomy_nodes.end()) continue;
-
-        // Set parent node NCBI ID
-        it->second.parent_id = split_line[NCBI_TAX_DUMP_COL_PARENT];
+    if (!parse_tax_dump(ncbi_nodes_path, &EntapDatabase::parse_tax_nodes_chunk, chunks)) {
+        return ERR_DATA_FILE_DECOMPRESS;
     }
-    infile_node.close();
+    for (TaxDumpChunk &chunk : chunks) {
+        for (std::pair<uint32, uint32> &entry : chunk.parents) {
+            // Node with no names, skip we don't want this
+            if (entry.first >= taxonomy_nodes.size() || taxonomy_nodes[entry.first].ncbi_id == 0) continue;
+            // Set parent node NCBI ID (unknown parents end lineage at root)
+            taxonomy_nodes[entry.first].parent_id = entry.second < taxonomy_nodes.size() ? entry.second : 0;
+        }
+    }
+    chunks.clear();
     FS_dprint("Success! Compiling final NCBI results...");
 
     // parse through entire map and generate NCBI taxonomy entries
     TaxEntry taxEntry;
-    for (auto &pair : taxonomy_nodes) {
+    if (type == ENTAP_SQL && !sql_bulk_begin()) return ERR_DATA_SQL_CREATE_ENTRY;
+    for (TaxonomyNode &node : taxonomy_nodes) {
+        if (node.ncbi_id == 0) continue;    // No names for this ID
+        // Same lineage for every name of a node
+        lineage = entap_tax_get_lineage(node, taxonomy_nodes);
         // want a separate entry for each name (doing this for now, may change)
-        for (std::string name : pair.second.names) {
+        for (std::string name : node.names) {
             LOWERCASE(name);
             current_entries++;
             taxEntry = {};
-            taxEntry.lineage = entap_tax_get_lineage(pair.second, taxonomy_nodes);
-            LOWERCASE(taxEntry.lineage);
-            taxEntry.tax_id  = pair.second.ncbi_id;
+            taxEntry.lineage = lineage;
+            taxEntry.tax_id  = std::to_string(node.ncbi_id);
             taxEntry.tax_name= name;
 
             // Add to SQL database or other...
             if (type == ENTAP_SQL) {
-                if (!sql_add_tax_entry(taxEntry)) {
+                if (!sql_add_tax_entry(taxEntry) || !sql_bulk_row()) {
                     // unable to add entry
                     FS_dprint("Unable to add tax entry: " + name);
+                    _pDatabaseHelper->rollback_transaction();
                     return ERR_DATA_SQL_CREATE_ENTRY;
                 }
             } else {
@@ -319,6 +327,10 @@ EntapDatabase::DATABASE_ERR EntapDatabase::generate_entap_tax(EntapDatabase::DAT
         }
         // ********************************************************** //
     }
+    if (type == ENTAP_SQL) {
+        if (!sql_bulk_end(SQL_TABLE_NCBI_TAX_TITLE)) return ERR_DATA_SQL_CREATE_ENTRY;
+        if (!create_sql_indexes(ENTAP_TAXONOMY)) return ERR_DATA_SQL_CREATE_TABLE;
+    }
     FS_dprint("Success! NCBI data complete");
     return ERR_DATA_OK;
 }
@@ -390,6 +402,7 @@ EntapDatabase::DATABASE_ERR EntapDatabase::generate_entap_go(EntapDatabase::DATA
     GoEntry goEntry;
     std::string num,term,cat,go,ex,ex1,ex2;
     io::CSVReader<7, io::trim_chars<' '>, io::no_quote_escape<'\t'>> in2(go_term_path);
+    if (type == ENTAP_SQL && !sql_bulk_begin()) return ERR_DATA_GO_ENTRY;
     while (in2.read_row(num,term,cat,go,ex,ex1,ex2)) {
         goEntry = {};
         goEntry.category = cat;
@@ -399,48 +412,261 @@ EntapDatabase::DATABASE_ERR EntapDatabase::generate_entap_go(EntapDatabase::DATA
 
         // Add to SQL database OR to overall map
         if (type == ENTAP_SQL) {
-            if (!sql_add_go_entry(goEntry)) {
+            if (!sql_add_go_entry(goEntry) || !sql_bulk_row()) {
                 FS_dprint("Unable to add GO entry: " + goEntry.go_id);
+                _pDatabaseHelper->rollback_transaction();
                 return ERR_DATA_GO_ENTRY;
             }
         } else {
             _pSerializedDatabase->gene_ontology_data[go] = goEntry;
         }
     }
+    if (type == ENTAP_SQL) {
+        if (!sql_bulk_end(SQL_TABLE_GO_TITLE)) return ERR_DATA_GO_ENTRY;
+        if (!create_sql_indexes(ENTAP_GENE_ONTOLOGY)) return ERR_DATA_SQL_CREATE_TABLE;
+    }
     FS_dprint("Success! Gene Ontology data complete");
 
     return ERR_DATA_OK;
 }
 
 
-// WARNING: recursive
+/**
+ * ======================================================================
+ * Function std::string EntapDatabase::entap_tax_get_lineage(TaxonomyNode &node,
+ *                              std::vector<TaxonomyNode>& nodes)
+ *
+ * Description          - Returns lowercase lineage of a node (scientific
+ *                        names up to root, ex: homo sapiens;homo;...;root)
+ *                      - Lineage of each ancestor is built once and kept
+ *                        on the ancestor, so a node only adds its own name
+ *                        to its parent's lineage
+ *
+ * Notes                - Ancestors are walked iteratively (no recursion on
+ *                        deep trees), leaves are not stored
+ *
+ * @param node          - Taxonomy node
+ * @param nodes         - All taxonomy nodes indexed by NCBI ID
+ *
+ * @return              - Lineage
+ *
+ * =====================================================================
+ */
 std::string EntapDatabase::entap_tax_get_lineage(EntapDatabase::TaxonomyNode &node,
-                                                 std::unordered_map<std::string,TaxonomyNode>& map) {
-    if (node.ncbi_id == "1" || node.ncbi_id == "") {
-        return "root";
-    } else {
-        return node.sci_name + ";" + entap_tax_get_lineage(map.at(node.parent_id), map);
+                                                 std::vector<TaxonomyNode>& nodes) {
+    std::vector<TaxonomyNode*> ancestors;   // Ancestors without a lineage yet, child first
+    TaxonomyNode *current;
+    const std::string *parent_lineage;
+    std::string   lineage;
+
+    if (is_tax_root(node)) return NCBI_TAX_ROOT_LINEAGE;
+
+    // Walk up until an ancestor with a known lineage (or root)
+    current = &nodes[node.parent_id];
+    while (!is_tax_root(*current) && current->lineage.empty()) {
+        ancestors.push_back(current);
+        current = &nodes[current->parent_id];
+    }
+    parent_lineage = is_tax_root(*current) ? &NCBI_TAX_ROOT_LINEAGE : &current->lineage;
+
+    // Fill lineages back down towards node
+    for (std::vector<TaxonomyNode*>::reverse_iterator it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+        lineage = (*it)->sci_name;
+        LOWERCASE(lineage);
+        (*it)->lineage = lineage + ";" + *parent_lineage;
+        parent_lineage = &(*it)->lineage;
+    }
+
+    lineage = node.sci_name;
+    LOWERCASE(lineage);
+    return lineage + ";" + *parent_lineage;
+}
+
+bool EntapDatabase::is_tax_root(TaxonomyNode &node) {
+    return node.ncbi_id == NCBI_TAX_ROOT_ID || node.ncbi_id == 0;
+}
+
+/**
+ * ======================================================================
+ * Function bool EntapDatabase::parse_tax_dump(std::string &path,
+ *                                  tax_dump_parser_t parser, std::vector<TaxDumpChunk> &chunks)
+ *
+ * Description          - Maps an NCBI taxdump file (names.dmp/nodes.dmp),
+ *                        splits it into line aligned byte ranges and parses
+ *                        each range on its own thread
+ *
+ * Notes                - Chunks are returned in file order
+ *
+ * @param path          - Path to taxdump file
+ * @param parser        - Chunk parser for this file
+ * @param chunks        - Filled with parsed chunks
+ *
+ * @return              - True/false if file could be mapped
+ *
+ * =====================================================================
+ */
+bool EntapDatabase::parse_tax_dump(std::string &path, tax_dump_parser_t parser,
+                                   std::vector<TaxDumpChunk> &chunks) {
+    boost::iostreams::mapped_file_source in_map;
+    std::vector<std::thread>             workers;
+    const char                          *data;
+    const char                          *split;
+    uint64                               map_size;
+    uint32                               thread_count;
+
+    try {
+        in_map.open(path);
+    } catch (const std::exception &e) {
+        FS_dprint("Unable to map taxonomy file: " + path + "\n" + e.what());
+        return false;
+    }
+    data     = in_map.data();
+    map_size = in_map.size();
+
+    thread_count = (uint32) std::min((uint64) _threads, map_size / TAX_CHUNK_MIN_SIZE + 1);
+    chunks.resize(thread_count);
+    split = data;
+    for (uint32 i = 0; i < thread_count; i++) {
+        chunks[i].begin = split;
+        if (i == thread_count - 1) {
+            split = data + map_size;
+        } else {
+            split = std::max(split, data + (map_size / thread_count) * (i + 1));
+            split = (const char*) memchr(split, '\n', (size_t) (data + map_size - split));
+            split = split == nullptr ? data + map_size : split + 1;
+        }
+        chunks[i].end = split;
+    }
+    FS_dprint("Parsing with " + std::to_string(thread_count) + " threads");
+
+    for (uint32 i = 1; i < thread_count; i++) {
+        workers.push_back(std::thread(parser, this, &chunks[i]));
+    }
+    (this->*parser)(&chunks[0]);
+    for (std::thread &worker : workers) worker.join();
+    in_map.close();
+    return true;
+}
+
+/**
+ * ======================================================================
+ * Function const char *EntapDatabase::next_tax_dump_field(const char *pos,
+ *                                            const char *end, const char **field_end)
+ *
+ * Description          - Tokenizes one field of a taxdump line in place
+ *                        (fields are separated by "\t|\t", lines end
+ *                        with "\t|")
+ *
+ * Notes                - None
+ *
+ * @param pos           - Start of field
+ * @param end           - End of line
+ * @param field_end     - Set to end of field value
+ *
+ * @return              - Start of next field (end if none)
+ *
+ * =====================================================================
+ */
+const char *EntapDatabase::next_tax_dump_field(const char *pos, const char *end, const char **field_end) {
+    const char *tab = (const char*) memchr(pos, NCBI_TAX_DUMP_DELIM, (size_t) (end - pos));
+
+    if (tab == nullptr) {
+        *field_end = end;
+        return end;
+    }
+    *field_end = tab;
+    // Skip "\t|\t"
+    return std::min(end, tab + 3);
+}
+
+/**
+ * ======================================================================
+ * Function void EntapDatabase::parse_tax_names_chunk(TaxDumpChunk *chunk)
+ *
+ * Description          - Parses names.dmp lines of a chunk into
+ *                        (tax ID, name, scientific) records
+ *                      - parse_tax_nodes_chunk parses nodes.dmp lines into
+ *                        (tax ID, parent tax ID) pairs
+ *
+ * Notes                - Run on worker threads, only touches chunk
+ *
+ * @param chunk         - Byte range to parse
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void EntapDatabase::parse_tax_names_chunk(TaxDumpChunk *chunk) {
+    const char *pos = chunk->begin;
+    const char *line_end;
+    const char *field_end;
+    const char *name;
+    const char *name_end;
+    const char *name_class;
+    const char *next_line;
+    TaxDumpName entry;
+
+    while (pos < chunk->end) {
+        line_end = (const char*) memchr(pos, '\n', (size_t) (chunk->end - pos));
+        if (line_end == nullptr) line_end = chunk->end;
+        next_line = line_end + 1;
+        if (line_end > pos && *(line_end - 1) == '\r') line_end--;
+
+        if (line_end > pos) {
+            entry.tax_id = (uint32) strtoul(pos, nullptr, 10);
+            name = next_tax_dump_field(pos, line_end, &field_end);       // tax ID
+            name_class = next_tax_dump_field(name, line_end, &name_end);  // name
+            name_class = next_tax_dump_field(name_class, line_end, &field_end); // unique name
+            next_tax_dump_field(name_class, line_end, &field_end);       // name class
+
+            entry.name.assign(name, name_end);
+            entry.scientific = (size_t) (field_end - name_class) == NCBI_TAX_DUMP_SCIENTIFIC.size() &&
+                    NCBI_TAX_DUMP_SCIENTIFIC.compare(0, std::string::npos, name_class,
+                                                     NCBI_TAX_DUMP_SCIENTIFIC.size()) == 0;
+            chunk->names.push_back(entry);
+        }
+        pos = next_line;
+    }
+}
+
+void EntapDatabase::parse_tax_nodes_chunk(TaxDumpChunk *chunk) {
+    const char *pos = chunk->begin;
+    const char *line_end;
+    const char *field_end;
+    const char *parent;
+    uint32      tax_id;
+
+    while (pos < chunk->end) {
+        line_end = (const char*) memchr(pos, '\n', (size_t) (chunk->end - pos));
+        if (line_end == nullptr) line_end = chunk->end;
+
+        if (line_end > pos && *pos != '\r') {
+            tax_id = (uint32) strtoul(pos, nullptr, 10);
+            parent = next_tax_dump_field(pos, line_end, &field_end);
+            chunk->parents.emplace_back(tax_id, (uint32) strtoul(parent, nullptr, 10));
+        }
+        pos = line_end + 1;
     }
 }
 
 bool EntapDatabase::sql_add_tax_entry(TaxEntry &taxEntry) {
-    char *sql_cmd;
+    sqlite3_stmt *stmt;
 
     if (_pDatabaseHelper == nullptr) return false;
 
-    sql_cmd = sqlite3_mprintf(
-            "INSERT INTO %Q (%Q,%Q,%Q) "\
-            "VALUES (%Q, %Q, %Q);",
-
-            SQL_TABLE_NCBI_TAX_TITLE.c_str(),
-            SQL_COL_NCBI_TAX_TAXID.c_str(),
-            SQL_COL_NCBI_TAX_LINEAGE.c_str(),
-            SQL_COL_NCBI_TAX_NAME.c_str(),
-            taxEntry.tax_id.c_str(),
-            taxEntry.lineage.c_str(),
-            taxEntry.tax_name.c_str()
-    );
-    return _pDatabaseHelper->execute_cmd(sql_cmd);
+    try {
+        stmt = _pDatabaseHelper->prepare(
+                "INSERT INTO " + SQL_TABLE_NCBI_TAX_TITLE + " (" + SQL_COL_NCBI_TAX_TAXID + "," +
+                SQL_COL_NCBI_TAX_LINEAGE + "," + SQL_COL_NCBI_TAX_NAME + ") VALUES (?, ?, ?)");
+        _pDatabaseHelper->bind(stmt, 1, taxEntry.tax_id);
+        _pDatabaseHelper->bind(stmt, 2, taxEntry.lineage);
+        _pDatabaseHelper->bind(stmt, 3, taxEntry.tax_name);
+        _pDatabaseHelper->step(stmt);
+    } catch (std::exception &e) {
+        FS_dprint(e.what());
+        return false;
+    }
+    return true;
 }
 
 bool EntapDatabase::create_sql_table(DATABASE_TYPE type) {
@@ -501,25 +727,154 @@ bool EntapDatabase::create_sql_table(DATABASE_TYPE type) {
 }
 
 bool EntapDatabase::sql_add_go_entry(GoEntry &goEntry) {
-    char *sql_cmd;
+    sqlite3_stmt *stmt;
 
     if (_pDatabaseHelper == nullptr) return false;
 
-    sql_cmd = sqlite3_mprintf(
-            "INSERT INTO %Q (%Q,%Q,%Q,%Q) "\
-            "VALUES (%Q, %Q, %Q, %Q);",
+    try {
+        stmt = _pDatabaseHelper->prepare(
+                "INSERT INTO " + SQL_TABLE_GO_TITLE + " (" + SQL_TABLE_GO_COL_ID + "," +
+                SQL_TABLE_GO_COL_DESC + "," + SQL_TABLE_GO_COL_CATEGORY + "," +
+                SQL_TABLE_GO_COL_LEVEL + ") VALUES (?, ?, ?, ?)");
+        _pDatabaseHelper->bind(stmt, 1, goEntry.go_id);
+        _pDatabaseHelper->bind(stmt, 2, goEntry.term);
+        _pDatabaseHelper->bind(stmt, 3, goEntry.category);
+        _pDatabaseHelper->bind(stmt, 4, goEntry.level);
+        _pDatabaseHelper->step(stmt);
+    } catch (std::exception &e) {
+        FS_dprint(e.what());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * ======================================================================
+ * Function bool EntapDatabase::create_sql_indexes(DATABASE_TYPE type)
+ *
+ * Description          - Creates lookup indexes for taxonomy (name) and
+ *                        Gene Ontology (GO ID) tables
+ *
+ * Notes                - Called once a table has been loaded, building the
+ *                        index afterwards is much faster than keeping it
+ *                        updated on every insert
+ *
+ * @param type          - ENTAP_TAXONOMY or ENTAP_GENE_ONTOLOGY
+ *
+ * @return              - True/false if successful
+ *
+ * =====================================================================
+ */
+bool EntapDatabase::create_sql_indexes(DATABASE_TYPE type) {
+    std::string sql_cmd;
+
+    if (_pDatabaseHelper == nullptr) return false;
+
+    switch (type) {
+        case ENTAP_TAXONOMY:
+            sql_cmd = "CREATE INDEX IF NOT EXISTS " + SQL_INDEX_NCBI_TAX_NAME + " ON " +
+                      SQL_TABLE_NCBI_TAX_TITLE + " (" + SQL_COL_NCBI_TAX_NAME + ");";
+            break;
+        case ENTAP_GENE_ONTOLOGY:
+            sql_cmd = "CREATE INDEX IF NOT EXISTS " + SQL_INDEX_GO_ID + " ON " +
+                      SQL_TABLE_GO_TITLE + " (" + SQL_TABLE_GO_COL_ID + ");";
+            break;
+        default:
+            return false;
+    }
+    FS_dprint("Creating SQL index: " + sql_cmd);
+    return _pDatabaseHelper->execute_cmd(&sql_cmd[0]);
+}
+
+/**
+ * ======================================================================
+ * Function bool EntapDatabase::sql_migrate_schema()
+ *
+ * Description          - Upgrades an existing (downloaded or previously
+ *                        generated) SQL database to the current schema
+ *                        version in place
+ *                      - Version 1 adds the lookup indexes, without them
+ *                        every taxonomy/GO lookup scans the whole table
+ *
+ * Notes                - Only runs the first time an older database is
+ *                        opened, the version is stamped afterwards
+ *
+ *
+ * @return              - True/false if database is at current version
+ *
+ * =====================================================================
+ */
+bool EntapDatabase::sql_migrate_schema() {
+    uint32 version;
+
+    try {
+        version = _pDatabaseHelper->get_user_version();
+    } catch (std::exception &e) {
+        FS_dprint(e.what());
+        return false;
+    }
+    if (version >= SQL_SCHEMA_VERSION) return true;
+
+    FS_dprint("Migrating EnTAP SQL database from schema version " + std::to_string(version) +
+              " to " + std::to_string(SQL_SCHEMA_VERSION) + "...");
+    // Steps are idempotent and the version is stamped last, an interrupted
+    // migration is simply redone next time
+    if (!create_sql_indexes(ENTAP_TAXONOMY) || !create_sql_indexes(ENTAP_GENE_ONTOLOGY) ||
+        !_pDatabaseHelper->set_user_version(SQL_SCHEMA_VERSION)) {
+        FS_dprint("Unable to migrate EnTAP SQL database, continuing without indexes");
+        return false;
+    }
+    FS_dprint("Success!");
+    return true;
+}
 
-            SQL_TABLE_GO_TITLE.c_str(),
-            SQL_TABLE_GO_COL_ID.c_str(),
-            SQL_TABLE_GO_COL_DESC.c_str(),
-            SQL_TABLE_GO_COL_CATEGORY.c_str(),
-            SQL_TABLE_GO_COL_LEVEL.c_str(),
-            goEntry.go_id.c_str(),
-            goEntry.term.c_str(),
-            goEntry.category.c_str(),
-            goEntry.level.c_str()
-    );
-    return _pDatabaseHelper->execute_cmd(sql_cmd);
+/**
+ * ======================================================================
+ * Function bool EntapDatabase::sql_bulk_begin()
+ *
+ * Description          - Bulk load mode for SQL generation. Inserts are
+ *                        grouped into transactions of SQL_BULK_COMMIT_ROWS
+ *                        rather than committed one at a time
+ *                      - sql_bulk_row is called after each insert,
+ *                        sql_bulk_end commits the remainder and reports
+ *                        the load rate
+ *
+ * Notes                - None
+ *
+ *
+ * @return              - True/false if successful
+ *
+ * =====================================================================
+ */
+bool EntapDatabase::sql_bulk_begin() {
+    _sql_bulk_rows  = 0;
+    _sql_bulk_start = std::chrono::steady_clock::now();
+    return _pDatabaseHelper->begin_transaction();
+}
+
+bool EntapDatabase::sql_bulk_row() {
+    fp64 seconds;
+
+    if (++_sql_bulk_rows % SQL_BULK_COMMIT_ROWS != 0) return true;
+
+    seconds = std::chrono::duration<fp64>(std::chrono::steady_clock::now() - _sql_bulk_start).count();
+    FS_dprint("Rows inserted: " + std::to_string(_sql_bulk_rows) + " (" +
+              std::to_string((uint64) (_sql_bulk_rows / std::max(seconds, 1e-3))) + " rows/sec)");
+    return _pDatabaseHelper->commit_transaction() && _pDatabaseHelper->begin_transaction();
+}
+
+bool EntapDatabase::sql_bulk_end(std::string table) {
+    fp64 seconds;
+
+    if (!_pDatabaseHelper->commit_transaction()) {
+        FS_dprint("Unable to commit rows to SQL table: " + table);
+        return false;
+    }
+    seconds = std::chrono::duration<fp64>(std::chrono::steady_clock::now() - _sql_bulk_start).count();
+    FS_dprint("Loaded " + std::to_string(_sql_bulk_rows) + " rows into " + table + " in " +
+              std::to_string(seconds) + "s (" +
+              std::to_string((uint64) (_sql_bulk_rows / std::max(seconds, 1e-3))) + " rows/sec)");
+    return true;
 }
 
 EntapDatabase::DATABASE_ERR EntapDatabase::download_entap_serial(std::string &out_path) {
@@ -582,36 +937,28 @@ GoEntry EntapDatabase::get_go_entry(std::string &go_id) {
 
     if (_use_serial) {
         // Using serialized database
-        go_serial_map_t::iterator it = _pSerializedDatabase->gene_ontology_data.find(go_id);
-        if (it == _pSerializedDatabase->gene_ontology_data.end()) {
+        if (!serial_find_go_entry(go_id, goEntry)) {
             FS_dprint("Unable to find GO ID: " + go_id);
             return GoEntry();
-        } else return it->second;
+        } else return goEntry;
 
     } else {
         // Using SQL database
-        std::vector<std::vector<std::string>> results;
+        sqlite3_stmt *stmt;
         // Check temp if previously found (increase speeds)
         go_serial_map_t::iterator it = _sql_go_helper.find(go_id);
         if (it != _sql_go_helper.end()) return it->second;
-        // Generate SQL query
-        char *query = sqlite3_mprintf(
-                "SELECT %q, %q, %q, %q FROM %q WHERE %q=%Q",
-                SQL_TABLE_GO_COL_ID.c_str(),
-                SQL_TABLE_GO_COL_DESC.c_str(),
-                SQL_TABLE_GO_COL_CATEGORY.c_str(),
-                SQL_TABLE_GO_COL_LEVEL.c_str(),
-                SQL_TABLE_GO_TITLE.c_str(),
-                SQL_TABLE_GO_COL_ID.c_str(),
-                go_id.c_str()
-        );
         try {
-            if (results.empty()) return GoEntry();
-            results = _pDatabaseHelper->query(query);
-            goEntry.go_id    = results[0][0];
-            goEntry.term     = results[0][1];
-            goEntry.category = results[0][2];
-            goEntry.level    = results[0][3];
+            stmt = _pDatabaseHelper->prepare(
+                    "SELECT " + SQL_TABLE_GO_COL_ID + ", " + SQL_TABLE_GO_COL_DESC + ", " +
+                    SQL_TABLE_GO_COL_CATEGORY + ", " + SQL_TABLE_GO_COL_LEVEL +
+                    " FROM " + SQL_TABLE_GO_TITLE + " WHERE " + SQL_TABLE_GO_COL_ID + "=?");
+            _pDatabaseHelper->bind(stmt, 1, go_id);
+            if (!_pDatabaseHelper->step(stmt)) return GoEntry();
+            goEntry.go_id    = SQLDatabaseHelper::column_string(stmt, 0);
+            goEntry.term     = SQLDatabaseHelper::column_string(stmt, 1);
+            goEntry.category = SQLDatabaseHelper::column_string(stmt, 2);
+            goEntry.level    = SQLDatabaseHelper::column_string(stmt, 3);
             _sql_go_helper[go_id] = goEntry;
             return goEntry;
         } catch (std::exception &e) {
@@ -622,59 +969,229 @@ GoEntry EntapDatabase::get_go_entry(std::string &go_id) {
     }
 }
 
+/**
+ * ======================================================================
+ * Function void EntapDatabase::set_threads(uint32 threads)
+ *
+ * Description          - Sets threads used to parse files when generating
+ *                        databases
+ *
+ * Notes                - Defaults to 1
+ *
+ * @param threads       - Thread count
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void EntapDatabase::set_threads(uint32 threads) {
+    _threads = std::max((uint32) 1, threads);
+}
+
+/**
+ * ======================================================================
+ * Function TaxEntry EntapDatabase::get_tax_entry(std::string &species)
+ *
+ * Description          - Returns taxonomic information (lineage, tax ID)
+ *                        of a species, broadening the name word by word
+ *                        until a match is found
+ *                      - Results are cached, including species that could
+ *                        not be found
+ *
+ * Notes                - Species is lowercased
+ *
+ * @param species       - Species to search for
+ *
+ * @return              - TaxEntry (empty if not found)
+ *
+ * =====================================================================
+ */
 TaxEntry EntapDatabase::get_tax_entry(std::string &species) {
     TaxEntry taxEntry;
-    std::string temp_species;
-    uint64 index;
 
     if (species.empty()) return TaxEntry();
 
     LOWERCASE(species); // ensure lowercase (database is based on this for direct matching)
 
-    if (_use_serial) {
-        // Using serialized database
-        tax_serial_map_t::iterator it = _pSerializedDatabase->taxonomic_data.find(species);
-        if (it == _pSerializedDatabase->taxonomic_data.end()) {
-            // If we can't find species, keep trying by making it more broad
-            temp_species = species;
-            while (true) {
-                index = temp_species.find_last_of(" ");
-                if (index == std::string::npos) break;
-                temp_species = temp_species.substr(0, index);
-                it = _pSerializedDatabase->taxonomic_data.find(temp_species);
-                if (it != _pSerializedDatabase->taxonomic_data.end()) {
-                    return it->second;
+    tax_cache_t::iterator it = _tax_cache.find(species);
+    if (it != _tax_cache.end()) return it->second;
+
+    taxEntry = find_tax_entry(species);
+    _tax_cache.emplace(species, taxEntry);
+    return taxEntry;
+}
+
+/**
+ * ======================================================================
+ * Function void EntapDatabase::resolve_batch(const vect_str_t &species_list)
+ *
+ * Description          - Resolves and caches taxonomic information for a
+ *                        set of species at once, so later calls to
+ *                        get_tax_entry do not access the database
+ *                      - SQL database is queried with one statement per
+ *                        batch of names (per broadening step) rather than
+ *                        one per species
+ *
+ * Notes                - Species that fail here are looked up individually
+ *                        by get_tax_entry
+ *
+ * @param species_list  - Unique species names
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void EntapDatabase::resolve_batch(const vect_str_t &species_list) {
+    std::vector<std::pair<std::string, std::string>> pending;    // species -> name being searched
+    std::vector<std::pair<std::string, std::string>> next_pending;
+    std::unordered_map<std::string, TaxEntry>        searched;   // name -> entry (empty if not found)
+    vect_str_t                                       names;
+    std::string                                      species;
+    uint64                                           index;
+
+    for (const std::string &name : species_list) {
+        species = name;
+        if (species.empty()) continue;
+        LOWERCASE(species);
+        if (_tax_cache.find(species) != _tax_cache.end()) continue;
+        if (_use_serial) {
+            get_tax_entry(species);
+        } else {
+            _tax_cache.emplace(species, TaxEntry());    // Placeholder, filled below
+            pending.emplace_back(species, species);
+        }
+    }
+    if (pending.empty()) return;
+    FS_dprint("Resolving taxonomic information for " + std::to_string(pending.size()) + " species...");
+
+    try {
+        while (!pending.empty()) {
+            // Query every name not searched for yet
+            names.clear();
+            for (std::pair<std::string, std::string> &entry : pending) {
+                if (searched.emplace(entry.second, TaxEntry()).second) names.push_back(entry.second);
+            }
+            for (uint64 i = 0; i < names.size(); i += TAX_BATCH_SIZE) {
+                sql_find_tax_entries(names, i, std::min((uint64) names.size(), i + TAX_BATCH_SIZE), searched);
+            }
+
+            // Broaden species that were not found
+            next_pending.clear();
+            for (std::pair<std::string, std::string> &entry : pending) {
+                TaxEntry &found = searched[entry.second];
+                if (!found.is_empty()) {
+                    _tax_cache[entry.first] = found;
+                    continue;
                 }
+                index = entry.second.find_last_of(" ");
+                if (index == std::string::npos) continue;   // couldn't find, cached as empty
+                next_pending.emplace_back(entry.first, entry.second.substr(0, index));
             }
-            return TaxEntry();
-        } else return it->second;
+            pending.swap(next_pending);
+        }
+    } catch (std::exception &e) {
+        // Do not fatal error, fall back to individual lookups
+        FS_dprint(e.what());
+        for (std::pair<std::string, std::string> &entry : pending) _tax_cache.erase(entry.first);
+    }
+}
+
+/**
+ * ======================================================================
+ * Function void EntapDatabase::sql_find_tax_entries(vect_str_t &names, uint64 start,
+ *                                        uint64 end, std::unordered_map<std::string, TaxEntry> &found)
+ *
+ * Description          - Looks up a range of exact taxonomic names in the
+ *                        SQL database with a single query
+ *
+ * Notes                - The first row (by ID) wins when a name is repeated,
+ *                        same as single lookups
+ *                      - Range must be at most TAX_BATCH_SIZE names
+ *
+ * @param names         - Names to search for
+ * @param start         - First index in names
+ * @param end           - One past last index in names
+ * @param found         - Updated with entries that were found
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void EntapDatabase::sql_find_tax_entries(vect_str_t &names, uint64 start, uint64 end,
+                                         std::unordered_map<std::string, TaxEntry> &found) {
+    sqlite3_stmt *stmt;
+    std::string   sql;
+
+    // Fixed number of parameters so one cached statement serves every batch
+    sql = "SELECT " + SQL_COL_NCBI_TAX_NAME + ", " + SQL_COL_NCBI_TAX_TAXID + ", " +
+          SQL_COL_NCBI_TAX_LINEAGE + " FROM " + SQL_TABLE_NCBI_TAX_TITLE + " WHERE " +
+          SQL_COL_NCBI_TAX_NAME + " IN (?";
+    for (uint64 i = 1; i < TAX_BATCH_SIZE; i++) sql += ",?";
+    sql += ") ORDER BY ID";
+
+    stmt = _pDatabaseHelper->prepare(sql);
+    for (uint64 i = 0; i < TAX_BATCH_SIZE; i++) {
+        if (start + i < end) {
+            _pDatabaseHelper->bind(stmt, (int) i + 1, names[start + i]);
+        } else {
+            _pDatabaseHelper->bind_null(stmt, (int) i + 1);   // never matches
+        }
+    }
+    _pDatabaseHelper->for_each_row(stmt, sql_add_found_tax_entry, &found);
+}
+
+/**
+ * ======================================================================
+ * Function TaxEntry EntapDatabase::find_tax_entry(std::string &species)
+ *
+ * Description          - Searches database for taxonomic information of a
+ *                        (lowercase) species, broadening if not found
+ *
+ * Notes                - None
+ *
+ * @param species       - Species to search for
+ *
+ * @return              - TaxEntry (empty if not found)
+ *
+ * =====================================================================
+ */
+TaxEntry EntapDatabase::find_tax_entry(std::string &species) {
+    TaxEntry taxEntry;
+    std::string temp_species;
+    uint64 index;
+
+    if (_use_serial) {
+        // Using serialized database
+        temp_species = species;
+        // If we can't find species, keep trying by making it more broad
+        while (!serial_find_tax_entry(temp_species, taxEntry)) {
+            index = temp_species.find_last_of(" ");
+            if (index == std::string::npos) return TaxEntry(); // couldn't find
+            temp_species = temp_species.substr(0, index);
+        }
+        return taxEntry;
 
     } else {
         // Using SQL database
-        std::vector<std::vector<std::string>> results;
+        sqlite3_stmt *stmt;
         temp_species = species;
         try {
+            stmt = _pDatabaseHelper->prepare(
+                    "SELECT " + SQL_COL_NCBI_TAX_TAXID + ", " + SQL_COL_NCBI_TAX_LINEAGE +
+                    " FROM " + SQL_TABLE_NCBI_TAX_TITLE + " WHERE " + SQL_COL_NCBI_TAX_NAME + "=?");
             // If we can't find species, keep trying by making it more broad
             while (true) {
-                // Generate SQL query
-                char *query = sqlite3_mprintf(
-                        "SELECT %q, %q FROM %q WHERE %q=%Q",
-                        SQL_COL_NCBI_TAX_TAXID.c_str(),
-                        SQL_COL_NCBI_TAX_LINEAGE.c_str(),
-                        SQL_TABLE_NCBI_TAX_TITLE.c_str(),
-                        SQL_COL_NCBI_TAX_NAME.c_str(),
-                        temp_species.c_str()
-                );
-                results = _pDatabaseHelper->query(query);
-                if (results.empty()) {
+                sqlite3_reset(stmt);
+                _pDatabaseHelper->bind(stmt, 1, temp_species);
+                if (!_pDatabaseHelper->step(stmt)) {
                     index = temp_species.find_last_of(" ");
                     if (index == std::string::npos) return TaxEntry(); // couldn't find
                     temp_species = temp_species.substr(0, index);
                 } else break; // Found species
             }
 
-            taxEntry.tax_id  = results[0][0];
-            taxEntry.lineage = results[0][1];
+            taxEntry.tax_id  = SQLDatabaseHelper::column_string(stmt, 0);
+            taxEntry.lineage = SQLDatabaseHelper::column_string(stmt, 1);
             taxEntry.tax_name= temp_species;
             return taxEntry;
 
@@ -696,24 +1213,31 @@ EntapDatabase::DATABASE_ERR EntapDatabase::serialize_database_save(SERIALIZATION
     }
 
     try {
-        std::ofstream file(out_path);
         switch (type) {
             case BOOST_TEXT_ARCHIVE: {
+                std::ofstream file(out_path);
                 boostAR::text_oarchive oa(file);
                 oa << *_pSerializedDatabase;
                 break;
             }
 
             case BOOST_BIN_ARCHIVE: {
+                std::ofstream file(out_path, std::ios::out | std::ios::binary);
                 boostAR::binary_oarchive oa_bin(file);
                 oa_bin << *_pSerializedDatabase;
                 break;
             }
 
+            case ENTAP_MAPPED_ARCHIVE:
+                if (!MappedDatabase::write(out_path, _pSerializedDatabase->taxonomic_data,
+                                           _pSerializedDatabase->gene_ontology_data)) {
+                    return ERR_DATA_SERIALIZE_SAVE;
+                }
+                break;
+
             default:
                 return ERR_DATA_SERIALIZE_SAVE;
         }
-        file.close();
     } catch (std::exception &e) {
         FS_dprint("Error in serializing EnTAP database!");
         return ERR_DATA_SERIALIZE_SAVE;
@@ -721,6 +1245,26 @@ EntapDatabase::DATABASE_ERR EntapDatabase::serialize_database_save(SERIALIZATION
     return ERR_DATA_OK;
 }
 
+/**
+ * ======================================================================
+ * Function EntapDatabase::DATABASE_ERR EntapDatabase::serialize_database_read(
+ *                                      SERIALIZATION_TYPE type, std::string &in_path)
+ *
+ * Description          - Opens serialized EnTAP database
+ *                      - Mapped databases are recognized by their magic
+ *                        number and queried in place, Boost archives
+ *                        (text or binary) are read into memory
+ *
+ * Notes                - type is only a hint, the format found in the file
+ *                        is used
+ *
+ * @param type          - Expected format
+ * @param in_path       - Path to database
+ *
+ * @return              - DATABASE_ERR
+ *
+ * =====================================================================
+ */
 EntapDatabase::DATABASE_ERR EntapDatabase::serialize_database_read(SERIALIZATION_TYPE type, std::string &in_path) {
     FS_dprint("Reading serialized database from: " + in_path);
 
@@ -730,7 +1274,23 @@ EntapDatabase::DATABASE_ERR EntapDatabase::serialize_database_read(SERIALIZATION
     }
 
     // Already generated? If no, generate
-    if (_pSerializedDatabase != nullptr) return ERR_DATA_OK;
+    if (_pSerializedDatabase != nullptr || _pMappedDatabase != nullptr) return ERR_DATA_OK;
+
+    if (MappedDatabase::is_mapped_database(in_path)) {
+        _pMappedDatabase = new MappedDatabase();
+        if (!_pMappedDatabase->open(in_path)) {
+            SAFE_DELETE(_pMappedDatabase);
+            return ERR_DATA_SERIALIZE_READ;
+        }
+        return ERR_DATA_OK;
+    }
+
+    // Legacy Boost archive, text archives begin with the (numeric) header length
+    {
+        std::ifstream ifs(in_path, std::ios::in | std::ios::binary);
+        type = isdigit(ifs.peek()) ? BOOST_TEXT_ARCHIVE : BOOST_BIN_ARCHIVE;
+    }
+    FS_dprint("Legacy Boost archive found, reading into memory...");
     _pSerializedDatabase = new EntapDatabaseStruct();
 
     try {
@@ -746,7 +1306,7 @@ EntapDatabase::DATABASE_ERR EntapDatabase::serialize_database_read(SERIALIZATION
 
             case BOOST_BIN_ARCHIVE:
             {
-                std::ifstream ifs(in_path);
+                std::ifstream ifs(in_path, std::ios::in | std::ios::binary);
                 boost::archive::binary_iarchive ia(ifs);
                 ia >> *_pSerializedDatabase;
                 ifs.close();
@@ -759,12 +1319,51 @@ EntapDatabase::DATABASE_ERR EntapDatabase::serialize_database_read(SERIALIZATION
 
     } catch (std::exception &e) {
         FS_dprint("Error in reading serialized database!");
+        SAFE_DELETE(_pSerializedDatabase);
         return ERR_DATA_SERIALIZE_READ;
     }
 
     return ERR_DATA_OK;
 }
 
+/**
+ * ======================================================================
+ * Function bool EntapDatabase::serial_find_tax_entry(const std::string &name, TaxEntry &entry)
+ *
+ * Description          - Exact match lookups in the serialized database,
+ *                        whichever form it was loaded in (mapped or
+ *                        in-memory archive)
+ *
+ * Notes                - None
+ *
+ * @param name          - Taxonomic name (serial_find_tax_entry) or GO ID
+ *                        (serial_find_go_entry)
+ * @param entry         - Set if found
+ *
+ * @return              - True if found
+ *
+ * =====================================================================
+ */
+bool EntapDatabase::serial_find_tax_entry(const std::string &name, TaxEntry &entry) {
+    if (_pMappedDatabase != nullptr) return _pMappedDatabase->get_tax_entry(name, entry);
+    if (_pSerializedDatabase == nullptr) return false;
+
+    tax_serial_map_t::iterator it = _pSerializedDatabase->taxonomic_data.find(name);
+    if (it == _pSerializedDatabase->taxonomic_data.end()) return false;
+    entry = it->second;
+    return true;
+}
+
+bool EntapDatabase::serial_find_go_entry(const std::string &go_id, GoEntry &entry) {
+    if (_pMappedDatabase != nullptr) return _pMappedDatabase->get_go_entry(go_id, entry);
+    if (_pSerializedDatabase == nullptr) return false;
+
+    go_serial_map_t::iterator it = _pSerializedDatabase->gene_ontology_data.find(go_id);
+    if (it == _pSerializedDatabase->gene_ontology_data.end()) return false;
+    entry = it->second;
+    return true;
+}
+
 std::string EntapDatabase::print_error_log(EntapDatabase::DATABASE_ERR err_code) {
     switch (err_code) {
         case ERR_DATA_SQL_CREATE_DATABASE:
@@ -787,8 +1386,7 @@ std::string EntapDatabase::print_error_log(EntapDatabase::DATABASE_ERR err_code)
     }
 }
 
-EntapDatabase::TaxonomyNode::TaxonomyNode(std::string id) {
-    parent_id = "";
-    sci_name = "";
-    ncbi_id = id;
+EntapDatabase::TaxonomyNode::TaxonomyNode() {
+    parent_id = 0;
+    ncbi_id   = 0;
 }
\ No newline at end of file
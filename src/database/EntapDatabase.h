@@ -31,6 +31,7 @@
 #include "../EntapGlobals.h"
 #include "../EntapConfig.h"
 #include "SQLDatabaseHelper.h"
+#include "MappedDatabase.h"
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/archive/binary_iarchive.hpp>
@@ -91,6 +92,8 @@ struct TaxEntry {
 
 class EntapDatabase {
 
+    typedef std::unordered_map<std::string, TaxEntry> tax_cache_t;
+
 public:
 
     typedef enum {
@@ -137,7 +140,8 @@ public:
     typedef enum {
 
         BOOST_TEXT_ARCHIVE=0,
-        BOOST_BIN_ARCHIVE
+        BOOST_BIN_ARCHIVE,
+        ENTAP_MAPPED_ARCHIVE    // Queried in place (MappedDatabase)
 
     } SERIALIZATION_TYPE;
 
@@ -153,16 +157,34 @@ public:
         }
     };
 
-    // Node for NCBI taxonomy
+    // Node for NCBI taxonomy, indexed by NCBI ID
     struct TaxonomyNode{
-        std::string parent_id;
-        std::string ncbi_id;
+        uint32      parent_id;
+        uint32      ncbi_id;    // 0 if no names were found for this ID
         std::string sci_name;
+        std::string lineage;    // Set once needed by a descendant, empty otherwise
         vect_str_t  names;
 
-        TaxonomyNode(std::string id);
+        TaxonomyNode();
+    };
+
+    // names.dmp entry
+    struct TaxDumpName {
+        uint32      tax_id;
+        std::string name;
+        bool        scientific;
     };
 
+    // Line aligned byte range of a mapped taxdump file parsed by one thread
+    struct TaxDumpChunk {
+        const char                           *begin;
+        const char                           *end;
+        std::vector<TaxDumpName>              names;     // names.dmp, file order
+        std::vector<std::pair<uint32,uint32>> parents;   // nodes.dmp, (tax ID, parent tax ID)
+    };
+
+    typedef void (EntapDatabase::*tax_dump_parser_t)(TaxDumpChunk*);
+
     EntapDatabase(FileSystem*);
     ~EntapDatabase();
     bool set_database(DATABASE_TYPE, std::string);
@@ -172,7 +194,9 @@ public:
 
     // Database accession routines
     TaxEntry get_tax_entry(std::string& species);
+    void resolve_batch(const vect_str_t &species_list);
     GoEntry get_go_entry(std::string& go_id);
+    void set_threads(uint32 threads);
 
     // Database accession routine (just making template)
 //    template<class T>
@@ -189,14 +213,27 @@ private:
     DATABASE_ERR generate_entap_serial(std::string&);
     DATABASE_ERR generate_entap_tax(DATABASE_TYPE, std::string);
     DATABASE_ERR generate_entap_go(DATABASE_TYPE, std::string);
-    std::string  entap_tax_get_lineage(TaxonomyNode &,
-                                       std::unordered_map<std::string, TaxonomyNode>&);
+    TaxEntry     find_tax_entry(std::string&);
+    void         sql_find_tax_entries(vect_str_t&, uint64, uint64, std::unordered_map<std::string, TaxEntry>&);
+    std::string  entap_tax_get_lineage(TaxonomyNode &, std::vector<TaxonomyNode>&);
+    bool         is_tax_root(TaxonomyNode&);
+    bool         parse_tax_dump(std::string&, tax_dump_parser_t, std::vector<TaxDumpChunk>&);
+    void         parse_tax_names_chunk(TaxDumpChunk*);
+    void         parse_tax_nodes_chunk(TaxDumpChunk*);
+    const char  *next_tax_dump_field(const char*, const char*, const char**);
     bool sql_add_tax_entry(TaxEntry&);
     bool sql_add_go_entry(GoEntry&);
     bool create_sql_table(DATABASE_TYPE);
+    bool create_sql_indexes(DATABASE_TYPE);
+    bool sql_migrate_schema();
+    bool sql_bulk_begin();
+    bool sql_bulk_row();
+    bool sql_bulk_end(std::string);
 
     DATABASE_ERR serialize_database_save(SERIALIZATION_TYPE, std::string&);
     DATABASE_ERR serialize_database_read(SERIALIZATION_TYPE, std::string&);
+    bool serial_find_tax_entry(const std::string&, TaxEntry&);
+    bool serial_find_go_entry(const std::string&, GoEntry&);
 
     // FTP Paths
     const std::string FTP_GO_DATABASE =
@@ -215,11 +252,10 @@ private:
     const char        NCBI_TAX_DUMP_DELIM    = '\t';
 
     // NCBI Taxonomy dump columns
-    const int NCBI_TAX_DUMP_COL_NAME_CLASS = 6; // Name type (scientific, authority...)
-    const int NCBI_TAX_DUMP_COL_ID         = 0;
-    const int NCBI_TAX_DUMP_COL_NAME       = 2; // Actual name
-    const int NCBI_TAX_DUMP_COL_PARENT     = 2; // Parent node in database
+    const uint32 NCBI_TAX_ROOT_ID          = 1;
+    const uint64 TAX_CHUNK_MIN_SIZE        = (1 << 20);   // Smallest byte range given to a thread
     const std::string NCBI_TAX_DUMP_SCIENTIFIC = "scientific name";
+    const std::string NCBI_TAX_ROOT_LINEAGE    = "root";
 
     // SQL Database Namings / Column numbers
     const std::string SQL_TABLE_NCBI_TAX_TITLE = "TAXONOMY";
@@ -231,6 +267,12 @@ private:
     const std::string SQL_TABLE_GO_COL_DESC    = "DESCRIPTION";
     const std::string SQL_TABLE_GO_COL_CATEGORY= "CATEGORY";
     const std::string SQL_TABLE_GO_COL_LEVEL   = "LEVEL";
+    const std::string SQL_INDEX_NCBI_TAX_NAME  = "TAXONOMY_TAXNAME_INDEX";
+    const std::string SQL_INDEX_GO_ID          = "GENEONTOLOGY_GOID_INDEX";
+    // Schema version stamped in PRAGMA user_version
+    //  0 - original layout, no secondary indexes
+    //  1 - TAXNAME and GOID indexes
+    const uint32      SQL_SCHEMA_VERSION       = 1;
 
     // Gene Ontology constants
     const std::string GO_BIOLOGICAL_LVL = "6679";
@@ -242,15 +284,22 @@ private:
     const std::string GO_TERMDB_DIR     = "go_monthly-termdb-tables/";
 
     // EnTAP database consts
-    const SERIALIZATION_TYPE SERIALIZE_DEFAULT    = BOOST_TEXT_ARCHIVE;
+    const SERIALIZATION_TYPE SERIALIZE_DEFAULT    = ENTAP_MAPPED_ARCHIVE;
 
     const uint8 STATUS_UPDATES = 5;     // Percentage of updates when downloading/configuring
+    const uint64 TAX_BATCH_SIZE = 500;  // Names per SQL query when resolving in batches
+    const uint64 SQL_BULK_COMMIT_ROWS = 100000; // Rows inserted per transaction when generating
 
     EntapDatabaseStruct *_pSerializedDatabase;
+    MappedDatabase      *_pMappedDatabase;
     FileSystem          *_pFilesystem;
     SQLDatabaseHelper   *_pDatabaseHelper;
     std::string          _temp_directory;
     go_serial_map_t      _sql_go_helper;    // Using to increase speeds for now, change later
+    tax_cache_t          _tax_cache;        // species -> entry, includes species not found
+    uint32               _threads;          // Threads used when generating
+    uint64               _sql_bulk_rows;    // Rows inserted during current bulk load
+    std::chrono::steady_clock::time_point _sql_bulk_start;
     bool                 _use_serial;
 
 
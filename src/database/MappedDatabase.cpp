@@ -0,0 +1,342 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//*********************** Includes *****************************
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include "MappedDatabase.h"
+#include "EntapDatabase.h"
+//**************************************************************
+
+constexpr char   MappedDatabase::MAGIC[8];
+constexpr uint32 MappedDatabase::VERSION;
+constexpr uint32 MappedDatabase::BUCKET_EMPTY;
+constexpr uint32 MappedDatabase::TAX_FIELDS;
+constexpr uint32 MappedDatabase::GO_FIELDS;
+
+// Appends a NUL terminated string to the string section, reusing identical values
+static uint64 write_string(std::ofstream &file, std::unordered_map<std::string, uint64> *written,
+                           uint64 &pos, const std::string &value) {
+    uint64 offset = pos;
+
+    if (written != nullptr) {
+        std::pair<std::unordered_map<std::string, uint64>::iterator, bool> result =
+                written->emplace(value, pos);
+        if (!result.second) return result.first->second;
+    }
+    file.write(value.c_str(), value.size() + 1);
+    pos += value.size() + 1;
+    return offset;
+}
+
+// Pads file with zeros to an 8 byte boundary
+static void write_padding(std::ofstream &file, uint64 &pos) {
+    static const char zeros[8] = {0};
+
+    if (pos % 8 != 0) {
+        file.write(zeros, 8 - pos % 8);
+        pos += 8 - pos % 8;
+    }
+}
+
+MappedDatabase::MappedDatabase() {
+    _header  = nullptr;
+    _strings = nullptr;
+}
+
+MappedDatabase::~MappedDatabase() {
+    close();
+}
+
+/**
+ * ======================================================================
+ * Function bool MappedDatabase::open(std::string &path)
+ *
+ * Description          - Maps database file read-only and validates the
+ *                        header, section bounds, field counts and index
+ *                        sizes
+ *
+ * Notes                - Nothing is read into memory, lookups page in
+ *                        only what they touch
+ *
+ * @param path          - Path to mapped database
+ *
+ * @return              - True/false if database is usable
+ *
+ * =====================================================================
+ */
+bool MappedDatabase::open(std::string &path) {
+    uint64 size;
+
+    close();
+    try {
+        _map.open(path);
+    } catch (const std::exception &e) {
+        FS_dprint("Unable to map EnTAP database: " + path + "\n" + e.what());
+        return false;
+    }
+    size    = _map.size();
+    _header = reinterpret_cast<const Header*>(_map.data());
+
+    if (size < sizeof(Header) || memcmp(_header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        _header->version != VERSION || _header->table_count != TABLE_COUNT ||
+        _header->strings_offset > size || _header->strings_size > size - _header->strings_offset ||
+        (_header->strings_size > 0 && _map.data()[_header->strings_offset + _header->strings_size - 1] != '\0')) {
+        FS_dprint("Invalid EnTAP database header: " + path);
+        close();
+        return false;
+    }
+    for (uint32 i = 0; i < TABLE_COUNT; i++) {
+        const TableHeader &table = _header->tables[i];
+        // Records must have the fields lookups read, and the index an empty bucket to end probes
+        if (table.field_count != (i == TABLE_TAXONOMY ? TAX_FIELDS : GO_FIELDS) ||
+            table.record_count >= BUCKET_EMPTY || table.bucket_count <= table.record_count ||
+            table.bucket_count == 0 || (table.bucket_count & (table.bucket_count - 1)) != 0 ||
+            table.fields_offset % 8 != 0 || table.buckets_offset % 8 != 0 ||
+            table.fields_offset > size || table.record_count * table.field_count > (size - table.fields_offset) / 8 ||
+            table.buckets_offset > size || table.bucket_count > (size - table.buckets_offset) / 4) {
+            FS_dprint("Invalid EnTAP database table: " + path);
+            close();
+            return false;
+        }
+    }
+    _strings = _map.data() + _header->strings_offset;
+    FS_dprint("Mapped EnTAP database: " + path + " (" +
+              std::to_string(_header->tables[TABLE_TAXONOMY].record_count) + " taxonomic entries, " +
+              std::to_string(_header->tables[TABLE_GENE_ONTOLOGY].record_count) + " GO entries)");
+    return true;
+}
+
+void MappedDatabase::close() {
+    if (_map.is_open()) _map.close();
+    _header  = nullptr;
+    _strings = nullptr;
+}
+
+/**
+ * ======================================================================
+ * Function bool MappedDatabase::get_tax_entry(const std::string &name, TaxEntry &entry)
+ *
+ * Description          - Exact match lookups of a taxonomic name / GO ID
+ *
+ * Notes                - tax_name is not stored, same as Boost archives
+ *
+ * @param name          - Taxonomic name (get_tax_entry) or GO ID (get_go_entry)
+ * @param entry         - Set if found
+ *
+ * @return              - True if found
+ *
+ * =====================================================================
+ */
+bool MappedDatabase::get_tax_entry(const std::string &name, TaxEntry &entry) const {
+    const uint64 *fields = find(TABLE_TAXONOMY, name);
+
+    if (fields == nullptr) return false;
+    entry.tax_id  = get_string(fields[1]);
+    entry.lineage = get_string(fields[2]);
+    return true;
+}
+
+bool MappedDatabase::get_go_entry(const std::string &go_id, GoEntry &entry) const {
+    const uint64 *fields = find(TABLE_GENE_ONTOLOGY, go_id);
+
+    if (fields == nullptr) return false;
+    entry.go_id    = get_string(fields[0]);
+    entry.level    = get_string(fields[1]);
+    entry.category = get_string(fields[2]);
+    entry.term     = get_string(fields[3]);
+    return true;
+}
+
+// Returns string offsets of the record matching key, nullptr if not found
+const uint64 *MappedDatabase::find(TABLE table, const std::string &key) const {
+    const TableHeader *header;
+    const uint64      *fields;
+    const uint32      *buckets;
+    uint64             mask;
+    uint64             index;
+    uint32             record;
+
+    if (_header == nullptr) return nullptr;
+    header  = &_header->tables[table];
+    fields  = reinterpret_cast<const uint64*>(_map.data() + header->fields_offset);
+    buckets = reinterpret_cast<const uint32*>(_map.data() + header->buckets_offset);
+    mask    = header->bucket_count - 1;
+
+    index = hash_key(key.c_str(), key.size()) & mask;
+    for (uint64 probes = 0; probes < header->bucket_count; probes++, index = (index + 1) & mask) {
+        record = buckets[index];
+        if (record == BUCKET_EMPTY || record >= header->record_count) return nullptr;
+        if (key.compare(get_string(fields[record * header->field_count])) == 0) {
+            return &fields[record * header->field_count];
+        }
+    }
+    return nullptr;
+}
+
+const char *MappedDatabase::get_string(uint64 offset) const {
+    return offset < _header->strings_size ? _strings + offset : "";
+}
+
+// FNV-1a, fixed so the index stays valid across builds
+uint64 MappedDatabase::hash_key(const char *key, uint64 len) {
+    uint64 hash = 14695981039346656037ULL;
+
+    for (uint64 i = 0; i < len; i++) {
+        hash ^= (unsigned char) key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * ======================================================================
+ * Function bool MappedDatabase::is_mapped_database(std::string &path)
+ *
+ * Description          - Checks whether file starts with the mapped
+ *                        database magic number
+ *
+ * Notes                - Used to tell this format apart from legacy Boost
+ *                        archives
+ *
+ * @param path          - Path to database
+ *
+ * @return              - True if mapped database
+ *
+ * =====================================================================
+ */
+bool MappedDatabase::is_mapped_database(std::string &path) {
+    char magic[sizeof(MAGIC)];
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+
+    if (!file.read(magic, sizeof(magic))) return false;
+    return memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+/**
+ * ======================================================================
+ * Function bool MappedDatabase::write(std::string &path, tax_serial_map_t &tax_data,
+ *                                     go_serial_map_t &go_data)
+ *
+ * Description          - Writes taxonomic and Gene Ontology entries in
+ *                        the mapped format
+ *
+ * Notes                - Header is written last so a partial file is never
+ *                        recognized as valid
+ *
+ * @param path          - Output path
+ * @param tax_data      - Taxonomic entries keyed by name
+ * @param go_data       - GO entries keyed by GO ID
+ *
+ * @return              - True/false if successful
+ *
+ * =====================================================================
+ */
+bool MappedDatabase::write(std::string &path, tax_serial_map_t &tax_data, go_serial_map_t &go_data) {
+    Header                                  header;
+    std::ofstream                           file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    std::unordered_map<std::string, uint64> written;    // Repeated values (lineages, levels...)
+    std::vector<const std::string*>         keys[TABLE_COUNT];
+    std::vector<uint64>                     fields[TABLE_COUNT];
+    std::vector<uint32>                     buckets;
+    uint64                                  pos;
+    uint64                                  index;
+
+    if (!file.is_open()) return false;
+    if (tax_data.size() >= BUCKET_EMPTY || go_data.size() >= BUCKET_EMPTY) return false;
+
+    memset(&header, 0, sizeof(header));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));   // Placeholder
+    pos = sizeof(header);
+    header.strings_offset = pos;
+
+    // String section, records sorted by key
+    for (tax_serial_map_t::iterator it = tax_data.begin(); it != tax_data.end(); ++it) {
+        keys[TABLE_TAXONOMY].push_back(&it->first);
+    }
+    for (go_serial_map_t::iterator it = go_data.begin(); it != go_data.end(); ++it) {
+        keys[TABLE_GENE_ONTOLOGY].push_back(&it->first);
+    }
+    for (std::vector<const std::string*> &table_keys : keys) {
+        std::sort(table_keys.begin(), table_keys.end(), compare_key_ptrs);
+    }
+    for (const std::string *key : keys[TABLE_TAXONOMY]) {
+        TaxEntry &entry = tax_data.at(*key);
+        fields[TABLE_TAXONOMY].push_back(write_string(file, nullptr, pos, *key));
+        fields[TABLE_TAXONOMY].push_back(write_string(file, &written, pos, entry.tax_id));
+        fields[TABLE_TAXONOMY].push_back(write_string(file, &written, pos, entry.lineage));
+    }
+    for (const std::string *key : keys[TABLE_GENE_ONTOLOGY]) {
+        GoEntry &entry = go_data.at(*key);
+        fields[TABLE_GENE_ONTOLOGY].push_back(write_string(file, nullptr, pos, *key));
+        fields[TABLE_GENE_ONTOLOGY].push_back(write_string(file, &written, pos, entry.level));
+        fields[TABLE_GENE_ONTOLOGY].push_back(write_string(file, &written, pos, entry.category));
+        fields[TABLE_GENE_ONTOLOGY].push_back(write_string(file, &written, pos, entry.term));
+    }
+    written.clear();
+    header.strings_size = pos - header.strings_offset;
+    for (uint64 &offset : fields[TABLE_TAXONOMY]) offset -= header.strings_offset;
+    for (uint64 &offset : fields[TABLE_GENE_ONTOLOGY]) offset -= header.strings_offset;
+    write_padding(file, pos);
+
+    // String offsets and hash index per table
+    for (uint32 table = 0; table < TABLE_COUNT; table++) {
+        TableHeader &table_header = header.tables[table];
+        table_header.record_count = keys[table].size();
+        table_header.field_count  = table == TABLE_TAXONOMY ? TAX_FIELDS : GO_FIELDS;
+        table_header.bucket_count = 1;
+        while (table_header.bucket_count < table_header.record_count * 2) table_header.bucket_count <<= 1;
+
+        table_header.fields_offset = pos;
+        file.write(reinterpret_cast<const char*>(fields[table].data()), fields[table].size() * sizeof(uint64));
+        pos += fields[table].size() * sizeof(uint64);
+
+        buckets.assign(table_header.bucket_count, BUCKET_EMPTY);
+        for (uint32 record = 0; record < keys[table].size(); record++) {
+            index = hash_key(keys[table][record]->c_str(), keys[table][record]->size());
+            while (buckets[index & (table_header.bucket_count - 1)] != BUCKET_EMPTY) index++;
+            buckets[index & (table_header.bucket_count - 1)] = record;
+        }
+        table_header.buckets_offset = pos;
+        file.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32));
+        pos += buckets.size() * sizeof(uint32);
+        write_padding(file, pos);
+    }
+
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version     = VERSION;
+    header.table_count = TABLE_COUNT;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    return !file.fail();
+}
+
+bool MappedDatabase::compare_key_ptrs(const std::string *a, const std::string *b) {
+    return *a < *b;
+}
@@ -0,0 +1,106 @@
+/*
+ *
+ * Developed by Alexander Hart
+ * Plant Computational Genomics Lab
+ * University of Connecticut
+ *
+ * For information, contact Alexander Hart at:
+ *     entap.dev@gmail.com
+ *
+ * Copyright 2017-2018, Alexander Hart, Dr. Jill Wegrzyn
+ *
+ * This file is part of EnTAP.
+ *
+ * EnTAP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EnTAP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EnTAP.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENTAP_MAPPEDDATABASE_H
+#define ENTAP_MAPPEDDATABASE_H
+
+#include <string>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include "../EntapGlobals.h"
+
+/*
+ * Read-only EnTAP database queried in place from a memory mapped file.
+ * Replaces deserializing the whole Boost archive into hash maps at
+ * startup: opening only maps the file, and pages are shared between
+ * EnTAP processes reading the same database.
+ *
+ * Layout (native byte order, every section 8 byte aligned):
+ *  - Header: magic, version, string section and one table header per table
+ *  - String section: NUL terminated strings, identical values stored once
+ *  - Per table:
+ *      fields  - record_count * field_count string offsets, records sorted
+ *                by key (first field)
+ *      buckets - open addressing hash index of record numbers
+ */
+class MappedDatabase {
+
+public:
+    typedef enum {
+
+        TABLE_TAXONOMY=0,       // name, tax ID, lineage
+        TABLE_GENE_ONTOLOGY,    // GO ID, level, category, term
+        TABLE_COUNT
+
+    } TABLE;
+
+    MappedDatabase();
+    ~MappedDatabase();
+    bool open(std::string &path);
+    void close();
+    bool get_tax_entry(const std::string&, TaxEntry&) const;
+    bool get_go_entry(const std::string&, GoEntry&) const;
+
+    static bool is_mapped_database(std::string &path);
+    static bool write(std::string &path, tax_serial_map_t&, go_serial_map_t&);
+
+private:
+    struct TableHeader {
+        uint64 record_count;
+        uint64 field_count;
+        uint64 bucket_count;    // Power of 2
+        uint64 fields_offset;   // File offset of string offsets
+        uint64 buckets_offset;  // File offset of hash index
+    };
+
+    struct Header {
+        char        magic[8];
+        uint32      version;
+        uint32      table_count;
+        uint64      strings_offset;
+        uint64      strings_size;
+        TableHeader tables[TABLE_COUNT];
+    };
+
+    const uint64 *find(TABLE, const std::string&) const;
+    const char   *get_string(uint64) const;
+
+    static uint64 hash_key(const char*, uint64);
+    static bool   compare_key_ptrs(const std::string*, const std::string*);
+
+    static constexpr char   MAGIC[8]       = {'E','N','T','A','P','M','D','B'};
+    static constexpr uint32 VERSION        = 1;
+    static constexpr uint32 BUCKET_EMPTY   = 0xFFFFFFFF;
+    static constexpr uint32 TAX_FIELDS     = 3;
+    static constexpr uint32 GO_FIELDS      = 4;
+
+    boost::iostreams::mapped_file_source _map;
+    const Header                        *_header;
+    const char                          *_strings;
+};
+
+
+#endif //ENTAP_MAPPEDDATABASE_H
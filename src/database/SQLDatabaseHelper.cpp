@@ -74,7 +74,9 @@ bool SQLDatabaseHelper::open(std::string file) {
  * =====================================================================
  */
 void SQLDatabaseHelper::close() {
+    finalize_statements();
     sqlite3_close(_database);
+    _database = NULL;
 }
 
 
@@ -139,6 +141,226 @@ std::vector<std::vector<std::string>> SQLDatabaseHelper::query(char *query) {
 }
 
 
+/**
+ * ======================================================================
+ * Function bool SQLDatabaseHelper::begin_transaction()
+ *
+ * Description          - Starts/commits/rolls back an explicit transaction
+ *                      - Used for bulk loading, inserts within a transaction
+ *                        are not committed one by one
+ *
+ * Notes                - None
+ *
+ *
+ * @return              - True/false if successful
+ *
+ * =====================================================================
+ */
+bool SQLDatabaseHelper::begin_transaction() {
+    return sqlite3_exec(_database, "BEGIN TRANSACTION", NULL, NULL, NULL) == SQLITE_OK;
+}
+
+bool SQLDatabaseHelper::commit_transaction() {
+    return sqlite3_exec(_database, "COMMIT TRANSACTION", NULL, NULL, NULL) == SQLITE_OK;
+}
+
+void SQLDatabaseHelper::rollback_transaction() {
+    sqlite3_exec(_database, "ROLLBACK TRANSACTION", NULL, NULL, NULL);
+}
+
+
+/**
+ * ======================================================================
+ * Function uint32 SQLDatabaseHelper::get_user_version()
+ *
+ * Description          - Reads/writes the database user_version header
+ *                        field, used to stamp the schema version
+ *
+ * Notes                - Defaults to 0 for databases never stamped
+ *
+ *
+ * @return              - Version (get), true/false if successful (set)
+ *
+ * =====================================================================
+ */
+uint32 SQLDatabaseHelper::get_user_version() {
+    sqlite3_stmt *stmt = prepare("PRAGMA user_version");
+    uint32 version = 0;
+
+    if (step(stmt)) version = (uint32) column_int(stmt, 0);
+    sqlite3_reset(stmt);
+    return version;
+}
+
+bool SQLDatabaseHelper::set_user_version(uint32 version) {
+    std::string cmd = "PRAGMA user_version = " + std::to_string(version);
+    return execute_cmd(&cmd[0]);
+}
+
+
+/**
+ * ======================================================================
+ * Function sqlite3_stmt *SQLDatabaseHelper::prepare(const std::string &sql)
+ *
+ * Description          - Returns prepared statement for SQL text, compiling
+ *                        it only the first time it is seen
+ *                      - Cached statements are reset with bindings cleared
+ *
+ * Notes                - Statement is owned by helper, do not finalize
+ *
+ * @param sql           - SQL statement (use ? for parameters)
+ *
+ * @return              - Prepared statement ready for binding
+ *
+ * =====================================================================
+ */
+sqlite3_stmt *SQLDatabaseHelper::prepare(const std::string &sql) {
+    sqlite3_stmt *stmt;
+    std::unordered_map<std::string, sqlite3_stmt*>::iterator it = _statements.find(sql);
+
+    if (it != _statements.end()) {
+        stmt = it->second;
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        return stmt;
+    }
+    if (sqlite3_prepare_v2(_database, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) {
+        throw ExceptionHandler("Error preparing database statement: " + sql + "\n" +
+                               sqlite3_errmsg(_database), ERR_ENTAP_DATABASE_QUERY);
+    }
+    _statements.emplace(sql, stmt);
+    return stmt;
+}
+
+
+/**
+ * ======================================================================
+ * Function void SQLDatabaseHelper::bind(sqlite3_stmt *stmt, int index, ...)
+ *
+ * Description          - Binds a parameter of a prepared statement
+ *
+ * Notes                - Index starts at 1 (sqlite convention)
+ *
+ * @param stmt          - Statement from prepare
+ * @param index         - Parameter index
+ * @param val           - Value to bind
+ *
+ * @return              - None
+ *
+ * =====================================================================
+ */
+void SQLDatabaseHelper::bind(sqlite3_stmt *stmt, int index, const std::string &val) {
+    if (sqlite3_bind_text(stmt, index, val.c_str(), (int) val.size(), SQLITE_TRANSIENT) != SQLITE_OK) {
+        throw ExceptionHandler("Error binding database parameter", ERR_ENTAP_DATABASE_QUERY);
+    }
+}
+
+void SQLDatabaseHelper::bind(sqlite3_stmt *stmt, int index, int64 val) {
+    if (sqlite3_bind_int64(stmt, index, val) != SQLITE_OK) {
+        throw ExceptionHandler("Error binding database parameter", ERR_ENTAP_DATABASE_QUERY);
+    }
+}
+
+void SQLDatabaseHelper::bind_null(sqlite3_stmt *stmt, int index) {
+    if (sqlite3_bind_null(stmt, index) != SQLITE_OK) {
+        throw ExceptionHandler("Error binding database parameter", ERR_ENTAP_DATABASE_QUERY);
+    }
+}
+
+
+/**
+ * ======================================================================
+ * Function bool SQLDatabaseHelper::step(sqlite3_stmt *stmt)
+ *
+ * Description          - Steps prepared statement to next result row
+ *
+ * Notes                - Throws ExceptionHandler on database error
+ *
+ * @param stmt          - Statement from prepare
+ *
+ * @return              - True if a row is available, false when done
+ *
+ * =====================================================================
+ */
+bool SQLDatabaseHelper::step(sqlite3_stmt *stmt) {
+    int stat = sqlite3_step(stmt);
+
+    if (stat == SQLITE_ROW) return true;
+    if (stat == SQLITE_DONE) return false;
+    throw ExceptionHandler(std::string("Error querying database: ") + sqlite3_errmsg(_database),
+                           ERR_ENTAP_DATABASE_QUERY);
+}
+
+
+/**
+ * ======================================================================
+ * Function uint64 SQLDatabaseHelper::for_each_row(sqlite3_stmt *stmt,
+ *                                    row_callback_t callback, void *data)
+ *
+ * Description          - Steps through results of a bound statement, handing
+ *                        each row to callback without copying it
+ *
+ * Notes                - Column values are only valid during the callback
+ *
+ * @param stmt          - Statement from prepare
+ * @param callback      - Called per row, returns false to stop
+ * @param data          - Passed through to callback
+ *
+ * @return              - Number of rows visited
+ *
+ * =====================================================================
+ */
+uint64 SQLDatabaseHelper::for_each_row(sqlite3_stmt *stmt, row_callback_t callback, void *data) {
+    uint64 count=0;
+
+    while (step(stmt)) {
+        count++;
+        if (!callback(stmt, data)) break;
+    }
+    return count;
+}
+
+
+/**
+ * ======================================================================
+ * Function std::string SQLDatabaseHelper::column_string(sqlite3_stmt *stmt, int col)
+ *
+ * Description          - Typed accessors for a column of the current row
+ *
+ * Notes                - Column index starts at 0, NULL is returned as
+ *                        empty/zero
+ *
+ * @param stmt          - Statement positioned on a row
+ * @param col           - Column index
+ *
+ * @return              - Column value
+ *
+ * =====================================================================
+ */
+std::string SQLDatabaseHelper::column_string(sqlite3_stmt *stmt, int col) {
+    const char *text = (const char*) sqlite3_column_text(stmt, col);
+
+    if (text == NULL) return "";
+    return std::string(text, (size_t) sqlite3_column_bytes(stmt, col));
+}
+
+int64 SQLDatabaseHelper::column_int(sqlite3_stmt *stmt, int col) {
+    return sqlite3_column_int64(stmt, col);
+}
+
+fp64 SQLDatabaseHelper::column_double(sqlite3_stmt *stmt, int col) {
+    return sqlite3_column_double(stmt, col);
+}
+
+
+void SQLDatabaseHelper::finalize_statements() {
+    for (std::pair<const std::string, sqlite3_stmt*> &pair : _statements) {
+        sqlite3_finalize(pair.second);
+    }
+    _statements.clear();
+}
+
+
 SQLDatabaseHelper::SQLDatabaseHelper() {
     _database = NULL;
 }
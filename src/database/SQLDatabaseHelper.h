@@ -30,6 +30,7 @@
 #define ENTAP_DATABASEHELPER_H
 
 #include <iostream>
+#include <unordered_map>
 #include "../common.h"
 #include "sqlite3.h"
 
@@ -39,16 +40,38 @@ class SQLDatabaseHelper {
 typedef std::vector<std::vector<std::string>> query_struct;
 
 public:
+    // Called once per result row, return false to stop stepping
+    typedef bool (*row_callback_t)(sqlite3_stmt*, void*);
+
     SQLDatabaseHelper();
     ~SQLDatabaseHelper();
     bool open(std::string file);
     bool create(std::string file);
     bool execute_cmd(char*);
+    bool begin_transaction();
+    bool commit_transaction();
+    void rollback_transaction();
+    uint32 get_user_version();
+    bool set_user_version(uint32);
     void close();
     query_struct query(char* query);
 
+    // Prepared statements, owned and cached by the helper (keyed by SQL text)
+    sqlite3_stmt *prepare(const std::string &sql);
+    void bind(sqlite3_stmt*, int, const std::string&);
+    void bind(sqlite3_stmt*, int, int64);
+    void bind_null(sqlite3_stmt*, int);
+    bool step(sqlite3_stmt*);
+    uint64 for_each_row(sqlite3_stmt*, row_callback_t, void*);
+    static std::string column_string(sqlite3_stmt*, int);
+    static int64 column_int(sqlite3_stmt*, int);
+    static fp64 column_double(sqlite3_stmt*, int);
+
 private:
+    void finalize_statements();
+
     sqlite3 *_database;
+    std::unordered_map<std::string, sqlite3_stmt*> _statements;
 };
 
 
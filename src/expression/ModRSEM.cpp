@@ -175,7 +175,7 @@ std::string ModRSEM::filter() {
     std::vector<uint16> all_lost_lengths;
     std::pair<uint64,uint64> kept_n;
     GraphingData        graphingStruct;
-    QUERY_MAP_T         *MAP;
+    QueryStore          *MAP;
 
     MAP = _pQueryData->get_sequences_ptr();
 
@@ -208,12 +208,11 @@ std::string ModRSEM::filter() {
     while (in.read_row(geneid, transid, in_len, e_leng, e_count, tpm, fpkm_val)) {
         count_total++;
         _pQueryData->trim_sequence_header(geneid,geneid);
-        QUERY_MAP_T::iterator it = MAP->find(geneid);
-        if (it == MAP->end()) {
+        QuerySequence *querySequence = MAP->find(geneid);
+        if (querySequence == nullptr) {
             throw ExceptionHandler("Unable to find sequence: " + geneid,
                                    ERR_ENTAP_RUN_RSEM_EXPRESSION_PARSE);
         }
-        QuerySequence *querySequence = it->second;
         length = (uint16)querySequence->getSeq_length();
         if (fpkm_val > _fpkm) {
             // Kept sequence
@@ -241,24 +241,24 @@ void ModGeneMarkST::parse() {
                 {FRAME_SELECTION_THREE_FLAG   ,0 },
         };
 
-        for (auto& pair : *_pQUERY_DATA->get_sequences_ptr()) {
-            std::map<std::string,frame_seq>::iterator p_it = protein_map.find(pair.first);
-            if (!pair.second->is_kept()) continue; // Skip seqs that were lost to expression
+        for (QuerySequence *query_seq : *_pQUERY_DATA->get_sequences_ptr()) {
+            std::map<std::string,frame_seq>::iterator p_it = protein_map.find(query_seq->get_seq_id());
+            if (!query_seq->is_kept()) continue; // Skip seqs that were lost to expression
             if (p_it != protein_map.end()) {
                 // Kept sequence, either partial, complete, or internal
                 count_selected++;
-                pair.second->setSequence(p_it->second.sequence); // Sets isprotein flag
-                pair.second->setFrame(p_it->second.frame_type);
+                query_seq->setSequence(p_it->second.sequence); // Sets isprotein flag
+                query_seq->setFrame(p_it->second.frame_type);
 
-                length = (uint16) pair.second->getSeq_length();  // Nucleotide sequence length
+                length = (uint16) query_seq->getSeq_length();  // Nucleotide sequence length
 
                 if (length < min_selected) {
                     min_selected = length;
-                    min_kept_seq = pair.first;
+                    min_kept_seq = query_seq->get_seq_id();
                 }
                 if (length > max_selected) {
                     max_selected = length;
-                    max_kept_seq = pair.first;
+                    max_kept_seq = query_seq->get_seq_id();
                 }
                 total_kept_len += length;
                 all_kept_lengths.push_back(length);
@@ -274,16 +274,16 @@ void ModGeneMarkST::parse() {
             } else {
                 // Lost sequence
                 count_removed++;
-                pair.second->QUERY_FLAG_CLEAR(QuerySequence::QUERY_FRAME_KEPT);
-                *file_map[FRAME_SELECTION_LOST_FLAG] << pair.second->get_sequence_n() << std::endl;
-                length = (uint16) pair.second->getSeq_length();  // Nucleotide sequence length
+                query_seq->QUERY_FLAG_CLEAR(QuerySequence::QUERY_FRAME_KEPT);
+                *file_map[FRAME_SELECTION_LOST_FLAG] << query_seq->get_sequence_n() << std::endl;
+                length = (uint16) query_seq->getSeq_length();  // Nucleotide sequence length
 
                 if (length < min_removed) {
                     min_removed = length;
-                    min_removed_seq = pair.first;
+                    min_removed_seq = query_seq->get_seq_id();
                 }
                 if (length > max_removed) {
-                    max_removed_seq = pair.first;
+                    max_removed_seq = query_seq->get_seq_id();
                     max_removed = length;
                 }
                 file_figure_removed << GRAPH_REJECTED_FLAG << '\t' << std::to_string(length) << std::endl;
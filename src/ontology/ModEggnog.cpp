@@ -141,8 +141,8 @@ void ModEggnog::parse() {
     while (in.read_row(qseqid, seed_ortho, seed_e, seed_score, predicted_gene, go_terms, kegg, tax_scope, ogs,
                        best_og, cog_cat, eggnog_annot)) {
         // Check if the query matches one of our original transcriptome sequences
-        QUERY_MAP_T::iterator it = (*_pQUERY_DATA->get_sequences_ptr()).find(qseqid);
-        if (it != (*_pQUERY_DATA->get_sequences_ptr()).end()) {
+        QuerySequence *query_seq = _pQUERY_DATA->get_sequence(qseqid);
+        if (query_seq != nullptr) {
             // EggNOG hit matches one of our original queries (from transcriptome)
 
             count_TOTAL_hits++;     // Increment number of EggNOG hits we got
@@ -161,12 +161,12 @@ void ModEggnog::parse() {
             get_sql_data(EggnogResults, EGGNOG_DATABASE);
             EggnogResults.parsed_go = parse_go_list(go_terms,_pEntapDatabase,',');
 
-            it->second->set_eggnog_results(EggnogResults);  // Set EggNOG results to maintained data
+            query_seq->set_eggnog_results(EggnogResults);  // Set EggNOG results to maintained data
 
             //  Analyze Gene Ontology Stats
             if (!EggnogResults.parsed_go.empty()) {
                 count_total_go_hits++;
-                it->second->QUERY_FLAG_SET(QuerySequence::QUERY_ONE_GO);
+                query_seq->QUERY_FLAG_SET(QuerySequence::QUERY_ONE_GO);
                 for (auto &pair : EggnogResults.parsed_go) {
                     // pair - first: GO category, second; vector of terms
                     for (std::string &term : pair.second) {
@@ -198,7 +198,7 @@ void ModEggnog::parse() {
                 count_total_kegg_hits++;
                 ct = (uint32) std::count(kegg.begin(), kegg.end(), ',');
                 count_total_kegg_terms += ct + 1;
-                it->second->QUERY_FLAG_SET(QuerySequence::QUERY_ONE_KEGG);
+                query_seq->QUERY_FLAG_SET(QuerySequence::QUERY_ONE_KEGG);
             } else {
                 count_no_kegg++;
             }
@@ -235,16 +235,18 @@ void ModEggnog::parse() {
 
     FS_dprint("Success! Computing overall statistics...");
     // Find how many original sequences did/did not hit the EggNOG database
-    for (auto &pair : *_pQUERY_DATA->get_sequences_ptr()) {
-        if (!pair.second->QUERY_FLAG_GET(QuerySequence::QUERY_EGGNOG_HIT)) {
+    QueryStore *sequences = _pQUERY_DATA->get_sequences_ptr();
+    for (uint32 query_id = 0; query_id < sequences->size(); query_id++) {
+        QuerySequence *query_seq = sequences->at(query_id);
+        if ((sequences->get_flags(query_id) & QuerySequence::QUERY_EGGNOG_HIT) == 0) {
             // Unannotated sequence
-            if (!pair.second->get_sequence_n().empty()) file_no_hits_nucl << pair.second->get_sequence_n() << std::endl;
-            if (!pair.second->get_sequence_p().empty()) file_no_hits_prot << pair.second->get_sequence_p() << std::endl;
+            if (!query_seq->get_sequence_n().empty()) file_no_hits_nucl << query_seq->get_sequence_n() << std::endl;
+            if (!query_seq->get_sequence_p().empty()) file_no_hits_prot << query_seq->get_sequence_p() << std::endl;
             count_no_hits++;
         } else {
             // Annotated sequence
-            if (!pair.second->get_sequence_n().empty()) file_hits_nucl << pair.second->get_sequence_n() << std::endl;
-            if (!pair.second->get_sequence_p().empty()) file_hits_prot << pair.second->get_sequence_p() << std::endl;
+            if (!query_seq->get_sequence_n().empty()) file_hits_nucl << query_seq->get_sequence_n() << std::endl;
+            if (!query_seq->get_sequence_p().empty()) file_hits_prot << query_seq->get_sequence_p() << std::endl;
         }
     }
 
@@ -515,19 +517,18 @@ void ModEggnog::get_tax_scope(std::string &raw_scope,
 void ModEggnog::get_sql_data(QuerySequence::EggnogResults &eggnogResults, SQLDatabaseHelper &database) {
     // Lookup description, KEGG, protein domain from SQL database
     if (!eggnogResults.og_key.empty()) {
-        std::vector<std::vector<std::string>>results;
+        sqlite3_stmt *stmt;
         std::string sql_kegg;
         std::string sql_desc;
         std::string sql_protein;
 
-        char *query = sqlite3_mprintf(
-                "SELECT description, KEGG_freq, SMART_freq FROM og WHERE og=%Q",
-                eggnogResults.og_key.c_str());
         try {
-            results = database.query(query);
-            sql_desc = results[0][0];
-            sql_kegg = results[0][1];
-            sql_protein = results[0][2];
+            stmt = database.prepare("SELECT description, KEGG_freq, SMART_freq FROM og WHERE og=?");
+            database.bind(stmt, 1, eggnogResults.og_key);
+            if (!database.step(stmt)) return;
+            sql_desc = SQLDatabaseHelper::column_string(stmt, 0);
+            sql_kegg = SQLDatabaseHelper::column_string(stmt, 1);
+            sql_protein = SQLDatabaseHelper::column_string(stmt, 2);
             if (!sql_desc.empty() && sql_desc.find("[]") != 0) eggnogResults.description = sql_desc;
             if (!sql_kegg.empty() && sql_kegg.find("[]") != 0) {
                 eggnogResults.sql_kegg = format_sql_data(sql_kegg);
@@ -184,26 +184,26 @@ void ModInterpro::parse() {
 
     // TODO stats
     try {
-        for (auto &pair : *_pQUERY_DATA->get_sequences_ptr()) {
-            std::map<std::string, InterProData>::iterator it = interpro_map.find(pair.first);
+        for (QuerySequence *query_seq : *_pQUERY_DATA->get_sequences_ptr()) {
+            std::map<std::string, InterProData>::iterator it = interpro_map.find(query_seq->get_seq_id());
             if (it != interpro_map.end()) {
                 count_hits++;
-                pair.second->QUERY_FLAG_SET(QuerySequence::QUERY_INTERPRO);
+                query_seq->QUERY_FLAG_SET(QuerySequence::QUERY_INTERPRO);
                 interpro_output = it->second.interID + "(" + it->second.interDesc + ")";
                 protein_output  = it->second.databaseID + "(" + it->second.databaseDesc + ")";
                 go_terms_parsed = parse_go_list(it->second.go_terms,_pEntapDatabase,',');
                 std::stringstream ss;
                 ss << std::scientific << it->second.eval;
                 e_str = ss.str();
-                pair.second->set_interpro_results(e_str, protein_output, it->second.databasetype,
+                query_seq->set_interpro_results(e_str, protein_output, it->second.databasetype,
                                                   interpro_output, it->second.pathways, go_terms_parsed);
-                if (!pair.second->get_sequence_n().empty()) file_hits_fnn << pair.second->get_sequence_n() << std::endl;
-                if (!pair.second->get_sequence_p().empty()) file_hits_faa << pair.second->get_sequence_p() << std::endl;
+                if (!query_seq->get_sequence_n().empty()) file_hits_fnn << query_seq->get_sequence_n() << std::endl;
+                if (!query_seq->get_sequence_p().empty()) file_hits_faa << query_seq->get_sequence_p() << std::endl;
             } else {
                 // Not InterPro hit
                 count_no_hits++;
-                if (!pair.second->get_sequence_n().empty()) file_no_hits_fnn << pair.second->get_sequence_n() << std::endl;
-                if (!pair.second->get_sequence_p().empty()) file_no_hits_faa << pair.second->get_sequence_p() << std::endl;
+                if (!query_seq->get_sequence_n().empty()) file_no_hits_fnn << query_seq->get_sequence_n() << std::endl;
+                if (!query_seq->get_sequence_p().empty()) file_no_hits_faa << query_seq->get_sequence_p() << std::endl;
             }
         }
     } catch (std::exception &e) {